@@ -1,5 +1,32 @@
 #include "Animation.h"
 
+#include <cstring>
+
+KeyLayout KeyLayout::Native()
+{
+	QuaternionKey key = {};
+	key.track = 1;
+	key.largest = 2;
+	key.sign = 1;
+
+	KeyLayout layout;
+	layout.endianness = 0x01020304;
+	layout.float3_key_size = sizeof(Float3Key);
+	layout.quaternion_key_size = sizeof(QuaternionKey);
+	memcpy(&layout.quaternion_key_bitfield, reinterpret_cast<const byte*>(&key) + sizeof(key.ratio), sizeof(layout.quaternion_key_bitfield));
+	layout.padding = 0;
+	return layout;
+}
+
+bool KeyLayout::IsNative() const
+{
+	const KeyLayout native = Native();
+	return endianness == native.endianness &&
+		float3_key_size == native.float3_key_size &&
+		quaternion_key_size == native.quaternion_key_size &&
+		quaternion_key_bitfield == native.quaternion_key_bitfield;
+}
+
 Animation::Animation() : duration_(0.f), num_tracks_(0), name_() 
 {
 }
@@ -17,6 +44,10 @@ Animation& Animation::operator=(Animation&& _other)
 	std::swap(translations_, _other.translations_);
 	std::swap(rotations_, _other.rotations_);
 	std::swap(scales_, _other.scales_);
+	std::swap(translations_view_, _other.translations_view_);
+	std::swap(rotations_view_, _other.rotations_view_);
+	std::swap(scales_view_, _other.scales_view_);
+	std::swap(storage_, _other.storage_);
 
 	return *this;
 }
@@ -31,6 +62,19 @@ void Animation::Allocate(size_t _translation_count, size_t _rotation_count, size
 	translations_.resize(_translation_count);
 	rotations_.resize(_rotation_count);
 	scales_.resize(_scale_count);
+	translations_view_ = make_span(translations_);
+	rotations_view_ = make_span(rotations_);
+	scales_view_ = make_span(scales_);
+	storage_.reset();
+}
+
+void Animation::Adopt(std::shared_ptr<const void> _storage, span<const Float3Key> _translations,
+	span<const QuaternionKey> _rotations, span<const Float3Key> _scales)
+{
+	storage_ = std::move(_storage);
+	translations_view_ = _translations;
+	rotations_view_ = _rotations;
+	scales_view_ = _scales;
 }
 
 void Animation::Deallocate()
@@ -38,6 +82,10 @@ void Animation::Deallocate()
 	translations_.clear();
     rotations_.clear();
     scales_.clear();
+	translations_view_ = span<const Float3Key>();
+	rotations_view_ = span<const QuaternionKey>();
+	scales_view_ = span<const Float3Key>();
+	storage_.reset();
 }
 
 size_t Animation::size() const 
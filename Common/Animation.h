@@ -4,6 +4,8 @@
 
 #include "span.h"
 
+#include <memory>
+
 // 定义动画关键帧类型（平移、旋转、缩放）。每种类型都是由关键时间比例及其轨道索引组成的相同基础。
 // 这是必需的，因为关键帧不是按轨道排序，而是按比率排序以支持缓存一致性。
 // 关键帧值根据其类型进行压缩。
@@ -36,6 +38,26 @@ struct QuaternionKey
     int16_t value[3];      // The quantized value of the 3 smallest components.
 };
 
+// Layout of the keys above. Files that store keys in their in-memory layout
+// record it, so that they are only read by a platform with the same one (see
+// LoadFile::MapAnimation and StreamingAnimation).
+struct KeyLayout
+{
+    uint32_t endianness;
+    uint16_t float3_key_size;
+    uint16_t quaternion_key_size;
+    // Bytes of the bitfield of a reference QuaternionKey, to detect compilers
+    // that lay it out differently.
+    uint16_t quaternion_key_bitfield;
+    uint16_t padding;
+
+    // Gets the layout of the running platform.
+    static KeyLayout Native();
+
+    // Tells if keys stored with this layout can be read as is.
+    bool IsNative() const;
+};
+
 //
 // 定义运行时骨骼动画剪辑。
 // 运行时动画数据结构为骨架的所有关节存储动画关键帧。该结构通常由 AnimationBuilder 填充并在运行时反序列化/加载。
@@ -45,6 +67,7 @@ struct QuaternionKey
 class Animation 
 {
     friend class LoadFile;
+    friend class StreamingAnimation;
 public:
     // Builds a default animation.
     Animation();
@@ -70,13 +93,18 @@ public:
     const std::string& name() const { return name_; }
 
     // Gets the buffer of translations keys.
-    const std::vector<Float3Key>& translations() const { return translations_; }
+    span<const Float3Key> translations() const { return translations_view_; }
 
     // Gets the buffer of rotation keys.
-    const std::vector<QuaternionKey>& rotations() const { return rotations_; }
+    span<const QuaternionKey> rotations() const { return rotations_view_; }
 
     // Gets the buffer of scale keys.
-    const std::vector<Float3Key>& scales() const { return scales_; }
+    span<const Float3Key> scales() const { return scales_view_; }
+
+    // Tells if keys, all or some of them, are views into a mapped file (see
+    // LoadFile::MapAnimation and LoadFile::LoadAnimation), rather than owned
+    // by the animation.
+    bool mapped() const { return storage_ != nullptr; }
 
     // Get the estimated animation's size in bytes.
     size_t size() const;
@@ -87,6 +115,11 @@ private:
 
     // Internal destruction function.
     void Allocate(size_t _translation_count, size_t _rotation_count, size_t _scale_count);
+
+    // Adopts _storage, which keys views can point into. Views can also point
+    // to the buffers above.
+    void Adopt(std::shared_ptr<const void> _storage, span<const Float3Key> _translations,
+        span<const QuaternionKey> _rotations, span<const Float3Key> _scales);
     void Deallocate();
 
     // Duration of the animation clip.
@@ -103,4 +136,12 @@ private:
     std::vector<Float3Key> translations_;
     std::vector<QuaternionKey> rotations_;
     std::vector<Float3Key> scales_;
+
+    // Keys views, either into the buffers above or into storage_.
+    span<const Float3Key> translations_view_;
+    span<const QuaternionKey> rotations_view_;
+    span<const Float3Key> scales_view_;
+
+    // Storage (a mapped file) some keys views point into, if any.
+    std::shared_ptr<const void> storage_;
 };
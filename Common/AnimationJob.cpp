@@ -34,6 +34,12 @@ bool AnimationJob::Validate() const
 	// Tests context size.
 	valid &= context->max_tracks() >= num_tracks;
 
+	// Sampling starts with the first 2 keys of every SoA padded track.
+	const size_t num_keys = static_cast<size_t>((num_tracks + 3) & ~3) * 2;
+	valid &= animation->translations().size() >= num_keys;
+	valid &= animation->rotations().size() >= num_keys;
+	valid &= animation->scales().size() >= num_keys;
+
 	return valid;
 }
 
@@ -41,11 +47,12 @@ namespace
 {
 	// Loops through the sorted key frames and update context structure.
 	template <typename _Key>
-	void UpdateCacheCursor(float _ratio, int num_tracks, const std::vector<_Key>& _keys, int* _cursor, std::vector<int>& _cache, std::vector<uint8_t>& _outdated)
+	void UpdateCacheCursor(float _ratio, int num_tracks, span<const _Key> _keys, int* _cursor, std::vector<int>& _cache, std::vector<uint8_t>& _outdated)
     {
-		assert(_keys.begin() + num_tracks * 2 <= _keys.end());
-
         const int _num_soa_tracks = (num_tracks + 3) / 4;
+		// Keys include SoA padding tracks.
+		const int num_padded_tracks = _num_soa_tracks * 4;
+		assert(_keys.begin() + num_padded_tracks * 2 <= _keys.end());
 
 		size_t cursor = 0;
 		if (!*_cursor) 
@@ -53,15 +60,15 @@ namespace
 			// Initializes interpolated entries with the first 2 sets of key frames.
 			// The sorting algorithm ensures that the first 2 key frames of a track
 			// are consecutive.
-			for (int i = 0; i < num_tracks; ++i)
+			for (int i = 0; i < num_padded_tracks; ++i)
 			{
 				const int in_index0 = i;                   // * soa size
-				const int in_index1 = in_index0 + num_tracks;  // 2nd row.
+				const int in_index1 = in_index0 + num_padded_tracks;  // 2nd row.
 				const int out_index = i * 2;
 				_cache[out_index + 0] = in_index0 + 0;
 				_cache[out_index + 1] = in_index1 + 0;
 			}
-			cursor = num_tracks * 2;  // New cursor position.
+			cursor = num_padded_tracks * 2;  // New cursor position.
 
 			// All entries are outdated. It cares to only flag valid soa entries as
 			// this is the exit condition of other algorithms.
@@ -74,7 +81,7 @@ namespace
 		else 
 		{
 			cursor = *_cursor;  // Might be == end()
-			assert(cursor >= num_tracks * 2 && cursor <= _keys.size());
+			assert(cursor >= num_padded_tracks * 2 && cursor <= _keys.size());
 		}
 
 		// Search for the keys that matches _ratio.
@@ -102,7 +109,7 @@ namespace
 
 	template <typename _Key, typename _InterpKey, typename _Decompress>
 	void UpdateInterpKeyframes(int num_tracks,
-		const std::vector<_Key>& _keys,
+		span<const _Key> _keys,
 		const std::vector<int>& _interp, std::vector<uint8_t>& _outdated,
 		std::vector<_InterpKey>& _interp_keys,
 		const _Decompress& _decompress) 
@@ -318,18 +325,19 @@ void AnimationJob::Context::Resize(int _max_tracks)
 	// Reset existing data.
 	Invalidate();
 
-	max_tracks_ = _max_tracks;
-
     const size_t max_soa_tracks = (_max_tracks + 3) / 4;
     const size_t num_outdated = (max_soa_tracks + 7) / 8;
 
-	soa_translations_.resize(_max_tracks);
-	soa_rotations_.resize(_max_tracks);
-	soa_scales_.resize(_max_tracks);
+	// Aligned to soa size, as padding tracks are sampled too.
+	max_tracks_ = static_cast<int>(max_soa_tracks * 4);
+
+	soa_translations_.resize(max_tracks_);
+	soa_rotations_.resize(max_tracks_);
+	soa_scales_.resize(max_tracks_);
 
-	translation_keys_.resize(_max_tracks * 2);
-	rotation_keys_.resize(_max_tracks * 2);
-	scale_keys_.resize(_max_tracks * 2);
+	translation_keys_.resize(max_tracks_ * 2);
+	rotation_keys_.resize(max_tracks_ * 2);
+	scale_keys_.resize(max_tracks_ * 2);
 
 	outdated_translations_.resize(num_outdated);
 	outdated_rotations_.resize(num_outdated);
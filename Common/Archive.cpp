@@ -0,0 +1,181 @@
+#include "Archive.h"
+
+#include "../System/NativeFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// Archive header, followed by the table of contents then by the entries.
+	struct Header
+	{
+		char tag[8];
+		uint32_t version;
+		uint32_t num_entries;
+	};
+
+	const char kTag[8] = "jy-pack";
+	const uint32_t kVersion = 1;
+
+	// Copies the content of _filename to _out at _offset.
+	bool CopyEntry(const std::string& _filename, uint64_t _size, NativeFile& _out, uint64_t _offset)
+	{
+		NativeFile file;
+		if (!file.Open(_filename.c_str(), NativeFile::OM_READ, NativeFile::AP_SEQUENTIAL))
+		{
+			return false;
+		}
+		std::vector<byte> buffer(static_cast<size_t>(std::min<uint64_t>(_size, 1024 * 1024)));
+		for (uint64_t copied = 0; copied < _size;)
+		{
+			const uint64_t chunk = std::min<uint64_t>(_size - copied, buffer.size());
+			if (!file.ReadAt(buffer.data(), chunk, copied) || !_out.WriteAt(buffer.data(), chunk, _offset + copied))
+			{
+				return false;
+			}
+			copied += chunk;
+		}
+		return true;
+	}
+}  // namespace
+
+uint64_t Archive::HashName(const char* _name, size_t _length)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < _length; ++i)
+	{
+		hash ^= static_cast<uint8_t>(_name[i]);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool Archive::Build(const std::string& _filename, const std::vector<Source>& _sources)
+{
+	// Builds the sorted table of contents, remembering the source of every
+	// entry.
+	std::vector<Entry> entries(_sources.size());
+	std::vector<size_t> order(_sources.size());
+	for (size_t i = 0; i < _sources.size(); ++i)
+	{
+		uint64 size;
+		if (!NativeFile::GetFileSize(_sources[i].filename.c_str(), size))
+		{
+			return false;
+		}
+		entries[i].hash = HashName(_sources[i].name);
+		entries[i].size = size;
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&entries](size_t _a, size_t _b)
+		{
+			return entries[_a].hash < entries[_b].hash;
+		});
+
+	std::vector<Entry> toc(entries.size());
+	uint64_t offset = Align(sizeof(Header) + sizeof(Entry) * toc.size(), kAlignment);
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		toc[i] = entries[order[i]];
+		if (i > 0 && toc[i].hash == toc[i - 1].hash)
+		{
+			return false;
+		}
+		toc[i].offset = offset;
+		offset = Align(offset + toc[i].size, kAlignment);
+	}
+
+	NativeFile file;
+	if (!file.Open(_filename.c_str(), NativeFile::OM_WRITE, NativeFile::AP_SEQUENTIAL))
+	{
+		return false;
+	}
+
+	Header header;
+	memcpy(header.tag, kTag, sizeof(header.tag));
+	header.version = kVersion;
+	header.num_entries = static_cast<uint32_t>(toc.size());
+	bool success = file.WriteAt(&header, sizeof(header), 0);
+	success &= toc.empty() || file.WriteAt(toc.data(), sizeof(Entry) * toc.size(), sizeof(header));
+
+	// Entries are written at their offset, padding in between is zero filled
+	// by the file system.
+	for (size_t i = 0; success && i < toc.size(); ++i)
+	{
+		success &= CopyEntry(_sources[order[i]].filename, toc[i].size, file, toc[i].offset);
+	}
+
+	return success;
+}
+
+Archive::Archive()
+{
+}
+
+Archive::~Archive()
+{
+	Close();
+}
+
+bool Archive::Open(const std::string& _filename)
+{
+	Close();
+	if (!mapping_.Open(_filename.c_str()))
+	{
+		return false;
+	}
+
+	const byte* data = mapping_.data();
+	const size_t size = mapping_.size();
+
+	Header header;
+	bool valid = size >= sizeof(header);
+	if (valid)
+	{
+		memcpy(&header, data, sizeof(header));
+		valid &= memcmp(header.tag, kTag, sizeof(header.tag)) == 0;
+		valid &= header.version == kVersion;
+		valid &= header.num_entries <= (size - sizeof(header)) / sizeof(Entry);
+	}
+	if (!valid)
+	{
+		Close();
+		return false;
+	}
+
+	// The mapping is page aligned, and the header keeps the table of contents
+	// aligned for its 64 bits fields.
+	entries_ = span<const Entry>(reinterpret_cast<const Entry*>(data + sizeof(header)), header.num_entries);
+	for (size_t i = 0; i < entries_.size(); ++i)
+	{
+		const Entry& entry = entries_[i];
+		valid &= entry.offset <= size && entry.size <= size - entry.offset;
+		valid &= i == 0 || entries_[i - 1].hash < entry.hash;
+	}
+	if (!valid)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void Archive::Close()
+{
+	entries_ = span<const Entry>();
+	mapping_.Close();
+}
+
+span<const byte> Archive::Find(uint64_t _hash) const
+{
+	const Entry* entry = std::lower_bound(entries_.begin(), entries_.end(), _hash, [](const Entry& _entry, uint64_t _value)
+		{
+			return _entry.hash < _value;
+		});
+	if (entry == entries_.end() || entry->hash != _hash)
+	{
+		return span<const byte>();
+	}
+	return span<const byte>(mapping_.data() + entry->offset, static_cast<size_t>(entry->size));
+}
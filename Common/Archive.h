@@ -0,0 +1,72 @@
+#pragma once
+
+#include "../System/MappedFile.h"
+#include "span.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Packs many asset files (skeletons, animations, meshes...) in a single file,
+// to avoid the cost of opening and sizing every one of them.
+// Entries are located by the hash of their name, in a table of contents sorted
+// by hash, with a binary search. Entries are stored 16 bytes aligned. The
+// archive is mapped, so opening it only reads the table of contents, and an
+// entry is only paged in when it's loaded. See the LoadFile functions taking an
+// Archive.
+class Archive
+{
+public:
+	// Alignment of the entries in the archive.
+	static const size_t kAlignment = 16;
+
+	// An entry to pack, and the asset file it's read from.
+	struct Source
+	{
+		std::string name;
+		std::string filename;
+	};
+
+	// Writes an archive made of _sources to _filename. Fails if a source file
+	// can't be read, or if two names have the same hash.
+	static bool Build(const std::string& _filename, const std::vector<Source>& _sources);
+
+	// Hash used to find entries, 64 bits FNV-1a of the name.
+	static uint64_t HashName(const char* _name, size_t _length);
+	static uint64_t HashName(const std::string& _name) { return HashName(_name.data(), _name.size()); }
+
+	Archive();
+	~Archive();
+
+	// Delete copies, the archive owns its mapping.
+	Archive(Archive const&) = delete;
+	Archive& operator=(Archive const&) = delete;
+
+	// Maps the archive _filename. Returns false if the file can't be mapped or
+	// isn't a valid archive.
+	bool Open(const std::string& _filename);
+	void Close();
+
+	bool IsOpen() const { return mapping_.IsOpen(); }
+
+	size_t num_entries() const { return entries_.size(); }
+
+	// Gets the content of an entry, or an empty span if there's none with this
+	// name. The span is valid until the archive is closed.
+	span<const byte> Find(const std::string& _name) const { return Find(HashName(_name)); }
+	span<const byte> Find(uint64_t _hash) const;
+
+private:
+	// Table of contents entry, as stored in the archive.
+	struct Entry
+	{
+		uint64_t hash;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	MappedFile mapping_;
+
+	// Table of contents, sorted by hash, in place in the mapping.
+	span<const Entry> entries_;
+};
@@ -0,0 +1,93 @@
+#include "AsyncLoader.h"
+#include "LoadFile.h"
+#include "Skeleton.h"
+#include "Animation.h"
+#include "Mesh.h"
+
+AsyncLoader::AsyncLoader(uint _numThreads)
+	: m_pending(0),
+	m_workers(_numThreads == 0 ? 1 : _numThreads)
+{
+}
+
+AsyncLoader::~AsyncLoader()
+{
+}
+
+template <typename _Asset, typename _Load>
+AsyncLoader::Handle<_Asset> AsyncLoader::_Queue(const std::string& _filename, Callback<_Asset> _callback, _Load _load)
+{
+	Handle<_Asset> request = std::make_shared<Request<_Asset>>(_filename);
+	++m_pending;
+
+	m_workers.Enqueue([this, request, _callback, _load]()
+		{
+			const bool success = _load(request->filename_, request->asset_);
+			request->status_.store(success ? kSucceeded : kFailed, std::memory_order_release);
+
+			// Callbacks are only posted here, and delivered by Update().
+			Completion completion = [this, request, _callback, success]()
+			{
+				_callback.ExecuteIfBound(*request);
+				OnCompleted.Broadcast(request->filename_, success);
+			};
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_completed.push_back(std::move(completion));
+			}
+			m_condition.notify_all();
+		});
+
+	return request;
+}
+
+AsyncLoader::Handle<Skeleton> AsyncLoader::LoadSkeleton(const std::string& _filename, Callback<Skeleton> _callback)
+{
+	return _Queue<Skeleton>(_filename, _callback, [](const std::string& _name, Skeleton& _skeleton)
+		{
+			return LoadFile::LoadSkeleton(_name, _skeleton);
+		});
+}
+
+AsyncLoader::Handle<Animation> AsyncLoader::LoadAnimation(const std::string& _filename, Callback<Animation> _callback)
+{
+	return _Queue<Animation>(_filename, _callback, [](const std::string& _name, Animation& _animation)
+		{
+			return LoadFile::LoadAnimation(_name, _animation);
+		});
+}
+
+AsyncLoader::Handle<std::vector<Mesh>> AsyncLoader::LoadMesh(const std::string& _filename, bool _quantize,
+	Callback<std::vector<Mesh>> _callback)
+{
+	return _Queue<std::vector<Mesh>>(_filename, _callback, [_quantize](const std::string& _name, std::vector<Mesh>& _meshes)
+		{
+			return LoadFile::LoadMesh(_name, _meshes, _quantize);
+		});
+}
+
+int AsyncLoader::Update()
+{
+	std::vector<Completion> completed;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		completed.swap(m_completed);
+	}
+
+	// Callbacks are called out of the lock, so they can queue new requests.
+	for (const Completion& completion : completed)
+	{
+		completion();
+	}
+	m_pending -= static_cast<int>(completed.size());
+	return static_cast<int>(completed.size());
+}
+
+int AsyncLoader::Flush()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_condition.wait(lock, [this] { return static_cast<int>(m_completed.size()) >= m_pending.load(); });
+	}
+	return Update();
+}
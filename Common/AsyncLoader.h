@@ -0,0 +1,112 @@
+#pragma once
+
+#include "../System/Delegate.h"
+#include "../System/ThreadPool.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Skeleton;
+class Animation;
+class Mesh;
+
+// Loads assets in the background, so that the game thread doesn't stall on
+// file reads and decoding when content streams in.
+// Every request returns a handle immediately, and is loaded by LoadFile on the
+// loader's worker threads. Completion callbacks are then delivered on the
+// thread calling Update(), typically once per frame from the game thread, so
+// they can safely use the loaded asset without any synchronization.
+class AsyncLoader
+{
+public:
+	enum Status
+	{
+		kPending,
+		kSucceeded,
+		kFailed,
+	};
+
+	// A loading request, shared between the caller and the workers.
+	template <typename _Asset>
+	class Request
+	{
+	public:
+		explicit Request(const std::string& _filename)
+			: filename_(_filename), status_(kPending) {}
+
+		const std::string& filename() const { return filename_; }
+
+		// Status can be polled from any thread. The asset must not be accessed
+		// before the request has succeeded.
+		Status status() const { return static_cast<Status>(status_.load(std::memory_order_acquire)); }
+		bool done() const { return status() != kPending; }
+
+		_Asset& asset() { return asset_; }
+		const _Asset& asset() const { return asset_; }
+
+	private:
+		friend class AsyncLoader;
+
+		std::string filename_;
+		std::atomic<int> status_;
+		_Asset asset_;
+	};
+
+	template <typename _Asset>
+	using Handle = std::shared_ptr<Request<_Asset>>;
+
+	// Per request completion callback, delivered by Update().
+	template <typename _Asset>
+	using Callback = Delegate<void, Request<_Asset>&>;
+
+	// Creates _numThreads workers. Loading is mostly bound by I/O, so a single
+	// worker is usually enough.
+	explicit AsyncLoader(uint _numThreads = 1);
+
+	// Waits for the pending requests, but drops their completion callbacks.
+	~AsyncLoader();
+
+	AsyncLoader(const AsyncLoader&) = delete;
+	AsyncLoader& operator=(const AsyncLoader&) = delete;
+
+	// Queues loading requests, see the LoadFile functions of the same name.
+	Handle<Skeleton> LoadSkeleton(const std::string& _filename, Callback<Skeleton> _callback = Callback<Skeleton>());
+	Handle<Animation> LoadAnimation(const std::string& _filename, Callback<Animation> _callback = Callback<Animation>());
+	Handle<std::vector<Mesh>> LoadMesh(const std::string& _filename, bool _quantize = false,
+		Callback<std::vector<Mesh>> _callback = Callback<std::vector<Mesh>>());
+
+	// Delivers the completion callbacks of the requests completed since the
+	// last call, on the calling thread. Returns the number of requests
+	// completed.
+	int Update();
+
+	// Blocks until all queued requests are completed, then delivers their
+	// callbacks as Update() does.
+	int Flush();
+
+	// Number of requests whose callbacks haven't been delivered yet.
+	int GetNumPending() const { return m_pending.load(); }
+
+	// Broadcast by Update() for every completed request, after the request's
+	// own callback, with the request filename and whether it succeeded.
+	MulticastDelegate<const std::string&, bool> OnCompleted;
+
+private:
+	typedef std::function<void()> Completion;
+
+	template <typename _Asset, typename _Load>
+	Handle<_Asset> _Queue(const std::string& _filename, Callback<_Asset> _callback, _Load _load);
+
+	std::atomic<int> m_pending;
+
+	// Completions posted by the workers, waiting for Update().
+	std::vector<Completion> m_completed;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+
+	// Declared last, so that workers are joined before anything they use is
+	// destroyed.
+	ThreadPool m_workers;
+};
@@ -13,7 +13,7 @@ BundleReader::~BundleReader()
     
 };
 
-void BundleReader::init(byte* buffer, ssize_t length)
+void BundleReader::init(const byte* buffer, ssize_t length)
 {
     _position = 0;
     _buffer  = buffer;
@@ -35,20 +35,20 @@ ssize_t BundleReader::read(void* ptr, ssize_t size, ssize_t count)
     {
         validCount = validLength/size;
         ssize_t readLength = size*validCount;
-        memcpy(ptr1,(byte*)_buffer+_position,readLength);
+        memcpy(ptr1,_buffer+_position,readLength);
         ptr1 += readLength;
         _position += readLength;
         readLength = validLength - readLength;
         if(readLength>0)
         {
-            memcpy(ptr1,(byte*)_buffer+_position,readLength);
+            memcpy(ptr1,_buffer+_position,readLength);
             _position += readLength;
 			validCount += 1;
 		}
     }
     else
     {
-        memcpy(ptr1,(byte*)_buffer+_position,needLength);
+        memcpy(ptr1,_buffer+_position,needLength);
         _position += needLength;
         validCount = count;
     }
@@ -56,12 +56,24 @@ ssize_t BundleReader::read(void* ptr, ssize_t size, ssize_t count)
     return validCount;
 }
 
+const byte* BundleReader::readBytes(ssize_t size)
+{
+    if (!_buffer || size < 0 || size > _length - _position)
+    {
+        return nullptr;
+    }
+
+    const byte* bytes = _buffer + _position;
+    _position += size;
+    return bytes;
+}
+
 byte* BundleReader::readLine(int num, byte* line)
 {
     if (!_buffer)
         return nullptr;
 
-    byte* buffer = (byte*)_buffer+_position;
+    const byte* buffer = _buffer+_position;
     byte* p = line;
     byte c;
     ssize_t readNum = 0;
@@ -131,6 +143,18 @@ bool BundleReader::rewind()
     return false;
 }
 
+bool BundleReader::readStringView(span<const char>* str)
+{
+    const ssize_t position = _position;
+    unsigned int length;
+    if (read(&length, 4, 1) != 1 || !readSpan(length, str))
+    {
+        _position = position;
+        return false;
+    }
+    return true;
+}
+
 std::string BundleReader::readString()
 {
     unsigned int length;
@@ -2,9 +2,14 @@
 #pragma once
 
 #include "../System/Macros.h"
+#include "span.h"
 
+#if PLATFORM_WIN32
 #include <BaseTsd.h>
 typedef SSIZE_T ssize_t;
+#else  // PLATFORM_WIN32
+#include <sys/types.h>
+#endif  // PLATFORM_WIN32
 
 class BundleReader
 {
@@ -13,10 +18,24 @@ public:
     BundleReader();
     ~BundleReader();
 
-    void init(byte* buffer, ssize_t length);
+    void init(const byte* buffer, ssize_t length);
 
     ssize_t read(void* ptr, ssize_t size, ssize_t count);
 
+    // Returns the next size bytes and moves past them, or nullptr if fewer
+    // bytes remain, so that whole arrays are bounds checked once.
+    const byte* readBytes(ssize_t size);
+
+    // Returns a view of the next count values of type T, moving past them.
+    // The view points into the reader's buffer, so nothing is copied, and is
+    // valid as long as the buffer. Returns false without moving if fewer bytes
+    // remain, or if the values aren't aligned for T.
+    template<typename T> bool readSpan(ssize_t count, span<const T>* values);
+
+    // Same as readString, but returns a view of the string in the buffer. The
+    // string isn't null terminated.
+    bool readStringView(span<const char>* str);
+
     byte* readLine(int num, byte* line);
 
     bool eof();
@@ -39,7 +58,7 @@ public:
 private:
     ssize_t _position;
     ssize_t  _length;
-    byte* _buffer;
+    const byte* _buffer;
 };
 
 
@@ -50,6 +69,23 @@ inline bool BundleReader::read(T *ptr)
 }
 
 
+template<typename T>
+inline bool BundleReader::readSpan(ssize_t count, span<const T>* values)
+{
+    if (!_buffer || count < 0 || count > (_length - _position) / static_cast<ssize_t>(sizeof(T)))
+    {
+        return false;
+    }
+    const byte* bytes = _buffer + _position;
+    if (count > 0 && reinterpret_cast<uintptr_t>(bytes) % alignof(T) != 0)
+    {
+        return false;
+    }
+    *values = span<const T>(reinterpret_cast<const T*>(bytes), count);
+    _position += sizeof(T) * count;
+    return true;
+}
+
 template<typename T>
 inline bool BundleReader::readArray(unsigned int *length, std::vector<T> *values)
 {
@@ -0,0 +1,21 @@
+#include "DualQuaternionPaletteJob.h"
+#include "../Math/3DMath.h"
+
+bool DualQuaternionPaletteJob::Validate() const
+{
+	return output.size() >= input.size();
+}
+
+bool DualQuaternionPaletteJob::Run() const
+{
+	if (!Validate()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < input.size(); ++i)
+	{
+		output[i] = Math::DualQuaternion(input[i]);
+	}
+
+	return true;
+}
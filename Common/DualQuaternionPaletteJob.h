@@ -0,0 +1,39 @@
+#pragma once
+
+#include "span.h"
+
+// Forward declaration math structures.
+namespace Math
+{
+	class Mat4;
+	class DualQuaternion;
+}
+
+// Converts skinning matrices to dual quaternions, to be used as
+// SkinningJob::joint_dual_quaternions.
+// Input matrices are the ones SkinningJob::joint_matrices would receive, aka
+// model-space matrices multiplied by inverse bind poses. Only their rigid part
+// is kept, scale is removed.
+struct DualQuaternionPaletteJob
+{
+	// Validates job parameters. Returns true for a valid job, or false otherwise:
+	// -if the size of the output is smaller than the input.
+	bool Validate() const;
+
+	// Runs job's conversion task.
+	// The job is validated before any operation is performed, see Validate() for
+	// more details.
+	// Returns false if job is not valid. See Validate() function.
+	bool Run() const;
+
+	// Job input.
+
+	// The skinning matrices to convert.
+	span<const Math::Mat4> input;
+
+	// Job output.
+
+	// The output range to be filled with unit dual quaternions, ordered like
+	// input. Each of them is 8 floats, half the size of a matrix.
+	span<Math::DualQuaternion> output;
+};
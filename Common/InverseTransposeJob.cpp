@@ -0,0 +1,106 @@
+#include "InverseTransposeJob.h"
+#include "../Math/3DMath.h"
+
+#include <cfloat>
+#include <cmath>
+
+const float InverseTransposeJob::kDefaultTolerance = 1e-3f;
+
+InverseTransposeJob::InverseTransposeJob()
+	: tolerance(kDefaultTolerance) {}
+
+bool InverseTransposeJob::Validate() const
+{
+	bool valid = true;
+	valid &= output.size() >= input.size();
+	valid &= non_uniform.size() * 32 >= input.size();
+	valid &= tolerance >= 0.f;
+	return valid;
+}
+
+namespace
+{
+	FORCEINLINE float Dot3(const float* _a, const float* _b)
+	{
+		return _a[0] * _b[0] + _a[1] * _b[1] + _a[2] * _b[2];
+	}
+
+	FORCEINLINE void Cross3(const float* _a, const float* _b, float* _out)
+	{
+		_out[0] = _a[1] * _b[2] - _a[2] * _b[1];
+		_out[1] = _a[2] * _b[0] - _a[0] * _b[2];
+		_out[2] = _a[0] * _b[1] - _a[1] * _b[0];
+	}
+
+	// Rows of the upper 3x3 part are orthogonal with the same length for a
+	// rotation with a uniform scale.
+	bool UniformScale(const float* _m, float _tolerance, float* _scale2)
+	{
+		const float* r0 = _m + 0;
+		const float* r1 = _m + 4;
+		const float* r2 = _m + 8;
+		const float l0 = Dot3(r0, r0);
+		const float epsilon = _tolerance * l0;
+		*_scale2 = l0;
+		return l0 > 0.f &&
+			std::fabs(Dot3(r1, r1) - l0) <= epsilon &&
+			std::fabs(Dot3(r2, r2) - l0) <= epsilon &&
+			std::fabs(Dot3(r0, r1)) <= epsilon &&
+			std::fabs(Dot3(r0, r2)) <= epsilon &&
+			std::fabs(Dot3(r1, r2)) <= epsilon;
+	}
+}  // namespace
+
+bool InverseTransposeJob::Run() const
+{
+	if (!Validate())
+	{
+		return false;
+	}
+
+	for (size_t w = 0; w < (input.size() + 31) / 32; ++w)
+	{
+		non_uniform[w] = 0;
+	}
+
+	for (size_t i = 0; i < input.size(); ++i)
+	{
+		const float* m = input[i].m;
+		float* out = output[i].m;
+
+		float scale2;
+		if (UniformScale(m, tolerance, &scale2))
+		{
+			// (s * R)^-T = R / s = m / s^2.
+			const float inv_scale2 = 1.f / scale2;
+			for (int k = 0; k < 12; ++k)
+			{
+				out[k] = m[k] * inv_scale2;
+			}
+		}
+		else
+		{
+			// Rows of the cofactor matrix are the cross products of the other
+			// rows, and the inverse transpose is cofactor / determinant.
+			non_uniform[i / 32] |= 1u << (i % 32);
+			Cross3(m + 4, m + 8, out + 0);
+			Cross3(m + 8, m + 0, out + 4);
+			Cross3(m + 0, m + 4, out + 8);
+			const float det = Dot3(m + 0, out + 0);
+			const float inv_det = std::fabs(det) > FLT_MIN ? 1.f / det : 1.f;
+			for (int k = 0; k < 12; ++k)
+			{
+				out[k] *= inv_det;
+			}
+		}
+		out[3] = 0.f;
+		out[7] = 0.f;
+		out[11] = 0.f;
+		out[12] = 0.f;
+		out[13] = 0.f;
+		out[14] = 0.f;
+		out[15] = 1.f;
+	}
+
+	return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "span.h"
+
+#include <cstdint>
+
+// Forward declaration math structures.
+namespace Math
+{
+	class Mat4;
+}
+
+// Computes the matrices used to transform normals from a skinning palette,
+// aka SkinningJob::joint_inverse_transpose_matrices.
+// Normals must be transformed by the inverse transpose of a matrix, which only
+// differs from the matrix by a scale factor when it's a rotation with a
+// uniform scale. Joints are analyzed to detect that common case, where the
+// inverse transpose is simply m / scale^2. The full inverse is only computed
+// for joints with a non-uniform scale (or shearing), which are flagged in the
+// non_uniform output bitset. SkinningJob then only blends inverse transpose
+// matrices for the vertices influenced by a flagged joint.
+// Only the upper 3x3 part of the output matrices is relevant, translation is
+// set to 0.
+struct InverseTransposeJob
+{
+	// Default relative tolerance used to detect uniform scale.
+	static const float kDefaultTolerance;
+
+	// Default constructor, initializes default values.
+	InverseTransposeJob();
+
+	// Validates job parameters. Returns true for a valid job, or false otherwise:
+	// -if output is smaller than input.
+	// -if non_uniform bitset is too small for input.
+	// -if tolerance is negative.
+	bool Validate() const;
+
+	// Runs job's inverse transpose task.
+	// The job is validated before any operation is performed, see Validate() for
+	// more details.
+	// Returns false if job is not valid. See Validate() function.
+	bool Run() const;
+
+	// Job input.
+
+	// Skinning matrices, as provided to SkinningJob::joint_matrices.
+	span<const Math::Mat4> input;
+
+	// Relative tolerance on rows lengths and orthogonality, below which a
+	// matrix is considered to have a uniform scale.
+	float tolerance;
+
+	// Job output.
+
+	// Inverse transpose matrices, one per input matrix.
+	span<Math::Mat4> output;
+
+	// Bitset of the joints with a non-uniform scale: bit i of word i / 32 is set
+	// for input[i]. At least (input.size() + 31) / 32 words are required.
+	span<uint32_t> non_uniform;
+};
@@ -0,0 +1,474 @@
+#include "KeyStreamCodec.h"
+
+#include <cstring>
+
+namespace
+{
+	// Byte planes keys are split to.
+	enum Plane
+	{
+		kRatio,  // Varint of the ratio bits delta.
+		kTrack,  // Varint of the zigzag track delta.
+		kValueLow,  // Low bytes of the zigzag values delta.
+		kValueHigh,  // High bytes of the zigzag values delta.
+		kLargest,  // QuaternionKey largest and sign.
+		kNumPlanes
+	};
+
+	// Planes storage modes.
+	enum Mode
+	{
+		kRaw,
+		kRans,
+	};
+
+	// rANS coder constants, 32 bits state with byte-wise renormalization, and
+	// 12 bits probabilities.
+	const uint32_t kProbBits = 12;
+	const uint32_t kProbScale = 1 << kProbBits;
+	const uint32_t kRansL = 1u << 23;
+
+	// Frequencies are capped so that every symbol costs at least 0.01 bit,
+	// which bounds the size of a decoded plane to kMaxRansExpansion times its
+	// encoded size.
+	const uint32_t kMaxFrequency = kProbScale - 32;
+	const size_t kMaxRansExpansion = KeyStreamCodec::kMaxKeysPerByte * 3;
+
+	void WriteVarint(uint32_t _value, std::vector<byte>* _out)
+	{
+		while (_value >= 0x80)
+		{
+			_out->push_back(static_cast<byte>(_value | 0x80));
+			_value >>= 7;
+		}
+		_out->push_back(static_cast<byte>(_value));
+	}
+
+	bool ReadVarint(const byte** _src, const byte* _end, uint32_t* _value)
+	{
+		uint32_t value = 0;
+		for (int shift = 0; shift < 35; shift += 7)
+		{
+			if (*_src == _end)
+			{
+				return false;
+			}
+			const byte b = *(*_src)++;
+			value |= static_cast<uint32_t>(b & 0x7f) << shift;
+			if (!(b & 0x80))
+			{
+				*_value = value;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	uint32_t ZigZag(int32_t _value) { return (static_cast<uint32_t>(_value) << 1) ^ static_cast<uint32_t>(_value >> 31); }
+	int32_t UnZigZag(uint32_t _value) { return static_cast<int32_t>(_value >> 1) ^ -static_cast<int32_t>(_value & 1); }
+
+	uint16_t ZigZag16(uint16_t _delta)
+	{
+		const int16_t delta = static_cast<int16_t>(_delta);
+		return static_cast<uint16_t>((static_cast<uint16_t>(delta) << 1) ^ static_cast<uint16_t>(delta >> 15));
+	}
+	uint16_t UnZigZag16(uint16_t _value)
+	{
+		return static_cast<uint16_t>((_value >> 1) ^ (0 - (_value & 1)));
+	}
+
+	// Normalizes symbols counts to frequencies summing to kProbScale, keeping
+	// every present symbol, and none above kMaxFrequency.
+	void NormalizeFrequencies(const uint32_t* _counts, size_t _total, uint32_t* _freqs)
+	{
+		uint32_t sum = 0;
+		int largest = 0;
+		for (int s = 0; s < 256; ++s)
+		{
+			_freqs[s] = 0;
+			if (_counts[s])
+			{
+				const uint32_t freq = static_cast<uint32_t>(static_cast<uint64_t>(_counts[s]) * kProbScale / _total);
+				_freqs[s] = freq ? freq : 1;
+				sum += _freqs[s];
+				largest = _freqs[s] > _freqs[largest] ? s : largest;
+			}
+		}
+		// Rounding errors are given to, or taken from, the most frequent symbols.
+		_freqs[largest] += kProbScale - sum;
+		while (static_cast<int32_t>(_freqs[largest]) <= 0)
+		{
+			int next = -1;
+			for (int s = 0; s < 256; ++s)
+			{
+				next = s != largest && _freqs[s] > 1 && (next < 0 || _freqs[s] > _freqs[next]) ? s : next;
+			}
+			const uint32_t taken = _freqs[next] - 1;
+			_freqs[next] -= taken;
+			_freqs[largest] += taken;
+		}
+		if (_freqs[largest] > kMaxFrequency)
+		{
+			_freqs[(largest + 1) & 0xff] += _freqs[largest] - kMaxFrequency;
+			_freqs[largest] = kMaxFrequency;
+		}
+	}
+
+	// Encodes _plane with rANS, returns false if it doesn't make it smaller.
+	bool EncodeRans(const std::vector<byte>& _plane, std::vector<byte>* _out)
+	{
+		uint32_t counts[256] = {};
+		for (byte b : _plane)
+		{
+			++counts[b];
+		}
+		uint32_t freqs[256];
+		uint32_t cums[256];
+		NormalizeFrequencies(counts, _plane.size(), freqs);
+		uint32_t num_symbols = 0;
+		for (uint32_t s = 0, cum = 0; s < 256; cum += freqs[s], ++s)
+		{
+			cums[s] = cum;
+			num_symbols += freqs[s] != 0;
+		}
+
+		// Symbols are encoded in reverse order, so that they're decoded
+		// forward. Every symbol outputs at most 2 bytes with 12 bits
+		// probabilities.
+		std::vector<byte> buffer(_plane.size() * 2 + 4);
+		byte* end = buffer.data() + buffer.size();
+		byte* ptr = end;
+		uint32_t x = kRansL;
+		for (size_t i = _plane.size(); i-- > 0;)
+		{
+			const uint32_t freq = freqs[_plane[i]];
+			const uint32_t x_max = ((kRansL >> kProbBits) << 8) * freq;
+			while (x >= x_max)
+			{
+				*--ptr = static_cast<byte>(x);
+				x >>= 8;
+			}
+			x = ((x / freq) << kProbBits) + (x % freq) + cums[_plane[i]];
+		}
+		ptr -= 4;
+		ptr[0] = static_cast<byte>(x);
+		ptr[1] = static_cast<byte>(x >> 8);
+		ptr[2] = static_cast<byte>(x >> 16);
+		ptr[3] = static_cast<byte>(x >> 24);
+
+		std::vector<byte> encoded;
+		WriteVarint(num_symbols, &encoded);
+		for (int s = 0; s < 256; ++s)
+		{
+			if (freqs[s])
+			{
+				encoded.push_back(static_cast<byte>(s));
+				WriteVarint(freqs[s], &encoded);
+			}
+		}
+		WriteVarint(static_cast<uint32_t>(end - ptr), &encoded);
+		encoded.insert(encoded.end(), ptr, end);
+		if (encoded.size() >= _plane.size())
+		{
+			return false;
+		}
+		_out->insert(_out->end(), encoded.begin(), encoded.end());
+		return true;
+	}
+
+	bool DecodeRans(const byte** _src, const byte* _end, byte* _plane, size_t _size)
+	{
+		uint32_t num_symbols;
+		if (!ReadVarint(_src, _end, &num_symbols) || num_symbols == 0 || num_symbols > 256)
+		{
+			return false;
+		}
+		uint32_t freqs[256] = {};
+		uint32_t cums[256] = {};
+		byte symbols[kProbScale];
+		uint32_t cum = 0;
+		for (uint32_t i = 0; i < num_symbols; ++i)
+		{
+			uint32_t freq;
+			if (*_src == _end)
+			{
+				return false;
+			}
+			const byte s = *(*_src)++;
+			if (!ReadVarint(_src, _end, &freq) || freq == 0 || freq > kMaxFrequency || freq > kProbScale - cum)
+			{
+				return false;
+			}
+			freqs[s] = freq;
+			cums[s] = cum;
+			memset(symbols + cum, s, freq);
+			cum += freq;
+		}
+		uint32_t encoded_size;
+		if (cum != kProbScale || !ReadVarint(_src, _end, &encoded_size) ||
+			encoded_size < 4 || encoded_size > static_cast<size_t>(_end - *_src) ||
+			_size > encoded_size * kMaxRansExpansion)
+		{
+			return false;
+		}
+		const byte* ptr = *_src;
+		const byte* end = ptr + encoded_size;
+		*_src = end;
+
+		uint32_t x = ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | (static_cast<uint32_t>(ptr[3]) << 24);
+		ptr += 4;
+		for (size_t i = 0; i < _size; ++i)
+		{
+			const uint32_t slot = x & (kProbScale - 1);
+			const byte s = symbols[slot];
+			_plane[i] = s;
+			x = freqs[s] * (x >> kProbBits) + slot - cums[s];
+			while (x < kRansL)
+			{
+				if (ptr == end)
+				{
+					return false;
+				}
+				x = (x << 8) | *ptr++;
+			}
+		}
+		// Encoder started from kRansL, and all bytes must have been consumed.
+		return ptr == end && x == kRansL;
+	}
+
+	void WritePlane(const std::vector<byte>& _plane, std::vector<byte>* _out)
+	{
+		WriteVarint(static_cast<uint32_t>(_plane.size()), _out);
+		const size_t mode = _out->size();
+		_out->push_back(kRans);
+		if (_plane.empty() || !EncodeRans(_plane, _out))
+		{
+			(*_out)[mode] = kRaw;
+			_out->insert(_out->end(), _plane.begin(), _plane.end());
+		}
+	}
+
+	// _max_size bounds the plane size before allocating.
+	bool ReadPlane(const byte** _src, const byte* _end, size_t _max_size, std::vector<byte>* _plane)
+	{
+		uint32_t size;
+		if (!ReadVarint(_src, _end, &size) || size > _max_size || *_src == _end)
+		{
+			return false;
+		}
+		const byte mode = *(*_src)++;
+		if (mode == kRaw)
+		{
+			if (size > static_cast<size_t>(_end - *_src))
+			{
+				return false;
+			}
+			_plane->assign(*_src, *_src + size);
+			*_src += size;
+			return true;
+		}
+		if (mode != kRans || size > static_cast<size_t>(_end - *_src) * kMaxRansExpansion)
+		{
+			return false;
+		}
+		_plane->resize(size);
+		return DecodeRans(_src, _end, _plane->data(), size);
+	}
+
+	// Access to the fields of the keys.
+	template <typename _Key>
+	struct KeyTraits;
+
+	template <>
+	struct KeyTraits<Float3Key>
+	{
+		static const bool kLargest = false;
+		static uint16_t GetValue(const Float3Key& _key, int _i) { return _key.value[_i]; }
+		static void SetValue(Float3Key* _key, int _i, uint16_t _value) { _key->value[_i] = _value; }
+		static byte GetLargest(const Float3Key&) { return 0; }
+		static void SetLargest(Float3Key*, byte) {}
+	};
+
+	template <>
+	struct KeyTraits<QuaternionKey>
+	{
+		static const bool kLargest = true;
+		static uint16_t GetValue(const QuaternionKey& _key, int _i) { return static_cast<uint16_t>(_key.value[_i]); }
+		static void SetValue(QuaternionKey* _key, int _i, uint16_t _value) { _key->value[_i] = static_cast<int16_t>(_value); }
+		static byte GetLargest(const QuaternionKey& _key) { return static_cast<byte>(_key.largest | (_key.sign << 2)); }
+		static void SetLargest(QuaternionKey* _key, byte _value)
+		{
+			_key->largest = _value & 3;
+			_key->sign = (_value >> 2) & 1;
+		}
+	};
+
+	// Keys of the SoA padding tracks are stored too, so tracks are valid up
+	// to the next multiple of 4.
+	int NumPaddedTracks(int _num_tracks)
+	{
+		return (_num_tracks + 3) & ~3;
+	}
+
+	template <typename _Key>
+	bool EncodeKeys(span<const _Key> _keys, int _num_tracks, std::vector<byte>* _out)
+	{
+		typedef KeyTraits<_Key> Traits;
+
+		if (_num_tracks < 0 || _num_tracks > KeyStreamCodec::kMaxTracks)
+		{
+			return false;
+		}
+		const int num_tracks = NumPaddedTracks(_num_tracks);
+
+		std::vector<byte> planes[kNumPlanes];
+		planes[kValueLow].reserve(_keys.size() * 3);
+		planes[kValueHigh].reserve(_keys.size() * 3);
+
+		std::vector<uint32_t> ratios(num_tracks, 0);
+		std::vector<uint16_t> values(num_tracks * 3, 0);
+		int previous_track = -1;
+		for (const _Key& key : _keys)
+		{
+			const int track = key.track;
+			if (track >= num_tracks)
+			{
+				return false;
+			}
+
+			uint32_t ratio;
+			memcpy(&ratio, &key.ratio, sizeof(ratio));
+			WriteVarint(ratio - ratios[track], &planes[kRatio]);
+			ratios[track] = ratio;
+
+			WriteVarint(ZigZag(track - previous_track - 1), &planes[kTrack]);
+			previous_track = track;
+
+			for (int i = 0; i < 3; ++i)
+			{
+				const uint16_t value = Traits::GetValue(key, i);
+				const uint16_t delta = ZigZag16(static_cast<uint16_t>(value - values[track * 3 + i]));
+				planes[kValueLow].push_back(static_cast<byte>(delta));
+				planes[kValueHigh].push_back(static_cast<byte>(delta >> 8));
+				values[track * 3 + i] = value;
+			}
+
+			if (Traits::kLargest)
+			{
+				planes[kLargest].push_back(Traits::GetLargest(key));
+			}
+		}
+
+		for (int p = 0; p < kNumPlanes; ++p)
+		{
+			if (p != kLargest || Traits::kLargest)
+			{
+				WritePlane(planes[p], _out);
+			}
+		}
+		return true;
+	}
+
+	template <typename _Key>
+	bool DecodeKeys(span<const byte>* _in, int _num_tracks, span<_Key> _keys)
+	{
+		typedef KeyTraits<_Key> Traits;
+
+		if (_num_tracks < 0 || _num_tracks > KeyStreamCodec::kMaxTracks)
+		{
+			return false;
+		}
+		const int num_tracks = NumPaddedTracks(_num_tracks);
+
+		const byte* src = _in->begin();
+		const byte* end = _in->end();
+		const size_t count = _keys.size();
+
+		// Varints take at most 5 bytes.
+		const size_t max_sizes[kNumPlanes] = { count * 5, count * 5, count * 3, count * 3, count };
+		std::vector<byte> planes[kNumPlanes];
+		for (int p = 0; p < kNumPlanes; ++p)
+		{
+			if ((p != kLargest || Traits::kLargest) && !ReadPlane(&src, end, max_sizes[p], &planes[p]))
+			{
+				return false;
+			}
+		}
+
+		if (planes[kValueLow].size() != count * 3 || planes[kValueHigh].size() != count * 3 ||
+			(Traits::kLargest && planes[kLargest].size() != count))
+		{
+			return false;
+		}
+
+		std::vector<uint32_t> ratios(num_tracks, 0);
+		std::vector<uint16_t> values(num_tracks * 3, 0);
+		const byte* ratio_src = planes[kRatio].data();
+		const byte* ratio_end = ratio_src + planes[kRatio].size();
+		const byte* track_src = planes[kTrack].data();
+		const byte* track_end = track_src + planes[kTrack].size();
+		const byte* low = planes[kValueLow].data();
+		const byte* high = planes[kValueHigh].data();
+		int previous_track = -1;
+		for (size_t k = 0; k < count; ++k)
+		{
+			_Key& key = _keys[k];
+
+			uint32_t track_delta;
+			if (!ReadVarint(&track_src, track_end, &track_delta))
+			{
+				return false;
+			}
+			const int track = previous_track + 1 + UnZigZag(track_delta);
+			if (track < 0 || track >= num_tracks)
+			{
+				return false;
+			}
+			previous_track = track;
+			key.track = static_cast<uint16_t>(track);
+
+			uint32_t ratio_delta;
+			if (!ReadVarint(&ratio_src, ratio_end, &ratio_delta))
+			{
+				return false;
+			}
+			ratios[track] += ratio_delta;
+			memcpy(&key.ratio, &ratios[track], sizeof(key.ratio));
+
+			for (int i = 0; i < 3; ++i)
+			{
+				const uint16_t delta = static_cast<uint16_t>(low[k * 3 + i] | (high[k * 3 + i] << 8));
+				values[track * 3 + i] += UnZigZag16(delta);
+				Traits::SetValue(&key, i, values[track * 3 + i]);
+			}
+
+			if (Traits::kLargest)
+			{
+				Traits::SetLargest(&key, planes[kLargest][k]);
+			}
+		}
+
+		*_in = span<const byte>(src, end);
+		return true;
+	}
+}  // namespace
+
+bool KeyStreamCodec::Encode(span<const Float3Key> _keys, int _num_tracks, std::vector<byte>* _out)
+{
+	return EncodeKeys(_keys, _num_tracks, _out);
+}
+
+bool KeyStreamCodec::Encode(span<const QuaternionKey> _keys, int _num_tracks, std::vector<byte>* _out)
+{
+	return EncodeKeys(_keys, _num_tracks, _out);
+}
+
+bool KeyStreamCodec::Decode(span<const byte>* _in, int _num_tracks, span<Float3Key> _keys)
+{
+	return DecodeKeys(_in, _num_tracks, _keys);
+}
+
+bool KeyStreamCodec::Decode(span<const byte>* _in, int _num_tracks, span<QuaternionKey> _keys)
+{
+	return DecodeKeys(_in, _num_tracks, _keys);
+}
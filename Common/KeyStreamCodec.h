@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Animation.h"
+#include "span.h"
+
+#include <vector>
+
+// Lossless compression of animation key streams, used by the compressed
+// animation files (see LoadFile::SaveCompressedAnimation).
+// Keys are first delta encoded against the previous key of the same track:
+// ratio as float bits (which increase with the ratio as ratios are positive),
+// and 16 bits values with wrap around. The track index is coded against the
+// track of the previous key of the stream, which is sequential for the first
+// keys. Deltas are split into byte planes with similar statistics, then every
+// plane is entropy coded with an order-0 rANS coder, or stored raw if it
+// doesn't compress. Decoding is a table lookup per byte, then a single pass
+// that rebuilds the keys.
+class KeyStreamCodec
+{
+public:
+	// Keys track is stored on 16 bits.
+	static const int kMaxTracks = 1 << 16;
+
+	// Upper bound of the number of keys a compressed byte can hold, so that
+	// the number of keys read from a file can be validated before allocating.
+	static const size_t kMaxKeysPerByte = 341;
+
+	// Appends the compressed _keys to _out. _num_tracks is the number of
+	// tracks of the animation, all keys tracks must be lower than it once
+	// rounded up to a multiple of 4, as SoA padding tracks have keys.
+	// Returns false if a key track is out of range.
+	static bool Encode(span<const Float3Key> _keys, int _num_tracks, std::vector<byte>* _out);
+	static bool Encode(span<const QuaternionKey> _keys, int _num_tracks, std::vector<byte>* _out);
+
+	// Decodes _keys.size() keys from _in, moving _in past the consumed bytes.
+	// Returns false if _in is truncated or corrupted.
+	static bool Decode(span<const byte>* _in, int _num_tracks, span<Float3Key> _keys);
+	static bool Decode(span<const byte>* _in, int _num_tracks, span<QuaternionKey> _keys);
+};
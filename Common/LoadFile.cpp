@@ -4,92 +4,50 @@
 #include "Animation.h"
 #include "RawAnimation.h"
 #include "Mesh.h"
+#include "Archive.h"
+#include "KeyStreamCodec.h"
+#include "../System/MappedFile.h"
+#include "../System/NativeFile.h"
 
-#define READ_IF_RETURN(cmp) if (cmp) { return false ;}
+#include <algorithm>
+#include <functional>
 
-struct Joint
-{
-	Joint(Joint* parent) : m_parent(parent) {}
-	~Joint()
-	{
-		for (int i = 0; i < m_children.size(); ++i)
-		{
-			SAFE_DELETE(m_children[i]);
-		}
-	}
-
-	void GetChildren(std::vector<Joint*>& allJoints)
-	{
-		allJoints.push_back(this);
-		for (int i = 0; i < m_children.size(); ++i)
-		{
-			m_children[i]->GetChildren(allJoints);
-		}
-	}
-
-	std::vector<Joint*> m_children;
-	Joint* m_parent;
-	std::string m_name;
-	Math::Transform m_transform;
-};
+#define READ_IF_RETURN(cmp) if (cmp) { return false ;}
 
-class RawSkeleton
+// Joints are stored depth-first, each one followed by the number of its
+// children, and by the version of the joint type if it has any.
+// Pending children of every ancestor of the current joint, which is the state
+// of the depth-first traversal.
+struct PendingJoints
 {
-	friend class LoadFile;
-public:
-	RawSkeleton() {}
-	~RawSkeleton()
-	{
-		for (int i = 0; i < m_roots.size(); ++i)
-		{
-			SAFE_DELETE(m_roots[i]);
-		}
-	}
-
-	void GetAllJoints(std::vector<Joint*>& allJoints)
-	{
-		for (int i = 0; i < m_roots.size(); ++i)
-		{
-			m_roots[i]->GetChildren(allJoints);
-		}
-	}
-
-private:
-	std::vector<Joint*> m_roots;
+	int16_t parent;
+	unsigned int remaining;
 };
 
-static bool __LoadJoint(BundleReader& binaryReader, Joint* joint)
+// Reads a joint, its name points to the reader's buffer.
+static bool __LoadJoint(BundleReader& binaryReader, const char*& name, const char*& name_end, Math::Transform& transform, unsigned int& num_child)
 {
 	unsigned int joint_name_size;
 	READ_IF_RETURN(binaryReader.read(&joint_name_size, 1, sizeof(joint_name_size)) != sizeof(joint_name_size));
-	char joint_name[32] = {};
-	READ_IF_RETURN(binaryReader.read(joint_name, 1, joint_name_size) != joint_name_size);
-	joint->m_name = joint_name;
+	name = reinterpret_cast<const char*>(binaryReader.readBytes(joint_name_size));
+	READ_IF_RETURN(!name);
+	// Stored size includes the null terminator.
+	name_end = std::find(name, name + joint_name_size, '\0');
 
-	READ_IF_RETURN(binaryReader.read(&joint->m_transform, 1, sizeof(joint->m_transform)) != sizeof(joint->m_transform));
+	READ_IF_RETURN(binaryReader.read(&transform, 1, sizeof(transform)) != sizeof(transform));
 
+	num_child = 0;
 	if (binaryReader.eof())
 	{
 		return true;
 	}
 
-	unsigned int num_child;
 	READ_IF_RETURN(binaryReader.read(&num_child, 1, sizeof(num_child)) != sizeof(num_child));
-
 	if (num_child > 0)
 	{
-		joint->m_children.reserve(num_child);
-
 		unsigned int joint_version;
 		READ_IF_RETURN(binaryReader.read(&joint_version, 1, sizeof(joint_version)) != sizeof(joint_version));
 		JY_ASSERT(joint_version == 1);
-
-		for (int i = 0; i < num_child; ++i)
-		{
-			joint->m_children.push_back(new Joint(joint));
-
-			__LoadJoint(binaryReader, joint->m_children.back());
-		}
 	}
 
 	return true;
@@ -97,31 +55,20 @@ static bool __LoadJoint(BundleReader& binaryReader, Joint* joint)
 
 bool LoadFile::LoadSkeleton(const std::string& filename, Skeleton& outSke)
 {
-    FILE* file = NULL;
-	fopen_s(&file, filename.c_str(), "rb");
-	if (file == NULL)
-		return false;
-
-	fseek(file, 0, SEEK_END);
-	int rawLength = ftell(file);
-	fseek(file, 0, SEEK_SET);
-	if (rawLength < 0)
-	{
-		fclose(file);
-		return false;
-	}
-
 	std::string readTexts;
-	readTexts.resize(rawLength);
-	int readLength = fread(&*readTexts.begin(), 1, rawLength, file);
-	fclose(file);
+	READ_IF_RETURN(!NativeFile::ReadWholeFile(filename.c_str(), readTexts));
 
 	BundleReader binaryReader;
-	binaryReader.init((byte*)readTexts.data(), readTexts.size());
+	binaryReader.init(reinterpret_cast<const byte*>(readTexts.data()), readTexts.size());
 
 	unsigned char endianness;
 	READ_IF_RETURN(binaryReader.read(&endianness, 1, 1) != 1);
 
+	return _LoadSkeleton(binaryReader, outSke);
+}
+
+bool LoadFile::_LoadSkeleton(BundleReader& binaryReader, Skeleton& outSke)
+{
 	// Read identifier info
 	std::string tag = "ozz-raw_skeleton";
 	char sig[32] = {};
@@ -134,40 +81,131 @@ bool LoadFile::LoadSkeleton(const std::string& filename, Skeleton& outSke)
 	unsigned int num_root;
 	READ_IF_RETURN(binaryReader.read(&num_root, 1, sizeof(num_root)) != sizeof(num_root));
 
-	// children
-	RawSkeleton rawSke;
-	rawSke.m_roots.reserve(num_root);
-
 	unsigned int joint_version;
 	READ_IF_RETURN(binaryReader.read(&joint_version, 1, sizeof(joint_version)) != sizeof(joint_version));
 	JY_ASSERT(joint_version == 1);
 
-	for (int i = 0; i < num_root; ++i)
+	// Joints are appended in depth-first order as they are read, the vectors
+	// keep their capacity when a skeleton is reloaded.
+	outSke.joint_rest_poses_.clear();
+	outSke.joint_parents_.clear();
+	outSke.joint_name_pool_.clear();
+	outSke.joint_name_offsets_.clear();
+
+	// Joints are read by a lambda, so that a failure at any point can clear
+	// the partially read skeleton below.
+	const auto load_joints = [&binaryReader, &outSke, num_root]() -> bool
+	{
+		// The traversal can't be deeper than the number of joints.
+		PendingJoints stack[Skeleton::kMaxJoints + 1];
+		stack[0].parent = Skeleton::kNoParent;
+		stack[0].remaining = num_root;
+		int depth = 1;
+		while (depth > 0)
+		{
+			PendingJoints& pending = stack[depth - 1];
+			if (pending.remaining == 0)
+			{
+				--depth;
+				continue;
+			}
+			--pending.remaining;
+
+			const int index = static_cast<int>(outSke.joint_parents_.size());
+			READ_IF_RETURN(index >= Skeleton::kMaxJoints);
+			const char* name;
+			const char* name_end;
+			Math::Transform transform;
+			unsigned int num_child;
+			READ_IF_RETURN(!__LoadJoint(binaryReader, name, name_end, transform, num_child));
+			outSke.joint_name_offsets_.push_back(static_cast<uint32_t>(outSke.joint_name_pool_.size()));
+			outSke.joint_name_pool_.insert(outSke.joint_name_pool_.end(), name, name_end);
+			outSke.joint_name_pool_.push_back('\0');
+			outSke.joint_rest_poses_.push_back(transform);
+			outSke.joint_parents_.push_back(pending.parent);
+			if (num_child > 0)
+			{
+				stack[depth].parent = static_cast<int16_t>(index);
+				stack[depth].remaining = num_child;
+				++depth;
+			}
+		}
+		return true;
+	};
+	const bool success = load_joints();
+	if (!success)
+	{
+		outSke.joint_rest_poses_.clear();
+		outSke.joint_parents_.clear();
+		outSke.joint_name_pool_.clear();
+		outSke.joint_name_offsets_.clear();
+	}
+
+	// Name index and levels are rebuilt in any case, so that they match the
+	// joints, even if there's none.
+	outSke.BuildJointNameIndex();
+	outSke.BuildHierarchyLevels();
+
+	return success;
+}
+
+// Stored size of animation keys, whose fields are serialized one after the
+// other.
+static constexpr size_t kFloat3KeyStoredSize = sizeof(float) + sizeof(uint16_t) * 4;
+static constexpr size_t kQuaternionKeyStoredSize = sizeof(float) + sizeof(uint16_t) + sizeof(uint8_t) * 2 + sizeof(int16_t) * 3;
+
+// Float3Key has no padding, so the stored layout is the in-memory one and the
+// whole array is copied at once. Keys are only allocated once the stored ones
+// are known to be in the buffer.
+static bool __LoadFloat3Keys(BundleReader& binaryReader, int32_t count, std::vector<Float3Key>& keys)
+{
+	static_assert(sizeof(Float3Key) == kFloat3KeyStoredSize, "Float3Key layout must match the stored one.");
+	const byte* src = binaryReader.readBytes(kFloat3KeyStoredSize * count);
+	READ_IF_RETURN(!src);
+	keys.resize(count);
+	if (count)
 	{
-		rawSke.m_roots.push_back(new Joint(nullptr));
-		__LoadJoint(binaryReader, rawSke.m_roots.back());
+		memcpy(keys.data(), src, kFloat3KeyStoredSize * count);
 	}
+	return true;
+}
 
-	// RawSkeleton TO Skeleton
-	std::vector<Joint*> joints;
-	std::unordered_map<Joint*, int> jointhash;
-	rawSke.GetAllJoints(joints);
-	auto numJoints = joints.size();
-	outSke.joint_rest_poses_.resize(numJoints);
-	outSke.joint_parents_.resize(numJoints, -1);
-	outSke.joint_names_.resize(numJoints);
-	for (int i = 0; i < numJoints; ++i)
+// QuaternionKey track, largest and sign are stored as separate fields, packed
+// to the bitfield by a single loop over the bounds checked array.
+static bool __LoadQuaternionKeys(BundleReader& binaryReader, int32_t count, std::vector<QuaternionKey>& keys)
+{
+	const byte* src = binaryReader.readBytes(kQuaternionKeyStoredSize * count);
+	READ_IF_RETURN(!src);
+	keys.resize(count);
+	QuaternionKey* key = keys.data();
+	for (int32_t i = 0; i < count; ++i, src += kQuaternionKeyStoredSize)
 	{
-		outSke.joint_names_[i] = joints[i]->m_name;
-		outSke.joint_rest_poses_[i] = joints[i]->m_transform;
-		outSke.joint_parents_[i] = i == 0 ? -1 : jointhash[joints[i]->m_parent];
-		jointhash[joints[i]] = i;
+		uint16_t track;
+		memcpy(&key[i].ratio, src, sizeof(float));
+		memcpy(&track, src + 4, sizeof(track));
+		key[i].track = track;
+		key[i].largest = src[6] & 3;
+		key[i].sign = src[7] & 1;
+		memcpy(key[i].value, src + 8, sizeof(key[i].value));
 	}
+	return true;
+}
 
+// Float3Key keys stored layout is the in-memory one, so they can be a view into
+// the reader's buffer if it's adopted. They are copied to keys otherwise, or if
+// they aren't aligned in the buffer.
+static bool __LoadFloat3Keys(BundleReader& binaryReader, bool adopt, int32_t count, std::vector<Float3Key>& keys, span<const Float3Key>& view)
+{
+	if (adopt && binaryReader.readSpan(count, &view))
+	{
+		return true;
+	}
+	READ_IF_RETURN(!__LoadFloat3Keys(binaryReader, count, keys));
+	view = make_span(keys);
 	return true;
 }
 
-bool LoadFile::_LoadAnimation(BundleReader& binaryReader, Animation& outAni)
+bool LoadFile::_LoadAnimation(BundleReader& binaryReader, Animation& outAni, const std::shared_ptr<const void>& storage)
 {
 	// Read identifier info
 	std::string tag = "ozz-animation";
@@ -190,71 +228,259 @@ bool LoadFile::_LoadAnimation(BundleReader& binaryReader, Animation& outAni)
 	READ_IF_RETURN(binaryReader.read(&translation_count, 1, sizeof(translation_count)) != sizeof(translation_count));
 	READ_IF_RETURN(binaryReader.read(&rotation_count, 1, sizeof(rotation_count)) != sizeof(rotation_count));
 	READ_IF_RETURN(binaryReader.read(&scale_count, 1, sizeof(scale_count)) != sizeof(scale_count));
-	outAni.Allocate(translation_count, rotation_count, scale_count);
+	READ_IF_RETURN(name_len < 0 || translation_count < 0 || rotation_count < 0 || scale_count < 0);
+	outAni.Deallocate();
+
+	const byte* name = binaryReader.readBytes(name_len);
+	READ_IF_RETURN(!name);
+	outAni.name_.assign(reinterpret_cast<const char*>(name), name_len);
+	outAni.name_.push_back('\0');
+
+	// QuaternionKey stored layout differs from the in-memory one, rotations
+	// are always decoded.
+	span<const Float3Key> translations;
+	span<const Float3Key> scales;
+	READ_IF_RETURN(!__LoadFloat3Keys(binaryReader, storage != nullptr, translation_count, outAni.translations_, translations));
+	READ_IF_RETURN(!__LoadQuaternionKeys(binaryReader, rotation_count, outAni.rotations_));
+	READ_IF_RETURN(!__LoadFloat3Keys(binaryReader, storage != nullptr, scale_count, outAni.scales_, scales));
+
+	// Storage is only kept if keys are views into it.
+	const bool adopted = (!translations.empty() && translations.data() != outAni.translations_.data()) ||
+		(!scales.empty() && scales.data() != outAni.scales_.data());
+	outAni.Adopt(adopted ? storage : nullptr, translations, make_span(outAni.rotations_), scales);
+
+	return true;
+}
 
-	outAni.name_.resize(name_len + 1);
-	READ_IF_RETURN(binaryReader.read((char*)outAni.name_.data(), 1, name_len) != name_len);
+bool LoadFile::LoadAnimation(const std::string& filename, Animation& outAni)
+{
+	std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>();
+	READ_IF_RETURN(!mapping->Open(filename.c_str()));
+
+	BundleReader binaryReader;
+	binaryReader.init(mapping->data(), mapping->size());
 
-	for (Float3Key& key : outAni.translations_)
+	unsigned char endianness;
+	READ_IF_RETURN(binaryReader.read(&endianness, 1, 1) != 1);
+
+	return _LoadAnimation(binaryReader, outAni, mapping);
+}
+
+// Runtime animation format, see LoadFile::MapAnimation.
+// Header is followed by the name, then by the translation, rotation and scale
+// keys arrays, each one starting on a kRuntimeAlignment boundary.
+struct RuntimeAnimationHeader
+{
+	char tag[8];
+	uint32_t version;
+	// Keys are stored in their in-memory layout, which must match the one of
+	// the platform that maps the file.
+	KeyLayout key_layout;
+	float duration;
+	int32_t num_tracks;
+	uint32_t name_len;
+	uint32_t translation_count;
+	uint32_t rotation_count;
+	uint32_t scale_count;
+	uint64_t translations_offset;
+	uint64_t rotations_offset;
+	uint64_t scales_offset;
+};
+
+static const char kRuntimeAnimationTag[8] = "jy-anim";
+static const uint32_t kRuntimeAnimationVersion = 1;
+static const uint64_t kRuntimeAlignment = 16;
+
+static void __FillRuntimeHeader(const Animation& ani, RuntimeAnimationHeader& header)
+{
+	memset(&header, 0, sizeof(header));
+	memcpy(header.tag, kRuntimeAnimationTag, sizeof(header.tag));
+	header.version = kRuntimeAnimationVersion;
+	header.key_layout = KeyLayout::Native();
+	header.duration = ani.Duration();
+	header.num_tracks = ani.num_tracks();
+	header.name_len = static_cast<uint32_t>(strlen(ani.name().c_str()));
+	header.translation_count = static_cast<uint32_t>(ani.translations().size());
+	header.rotation_count = static_cast<uint32_t>(ani.rotations().size());
+	header.scale_count = static_cast<uint32_t>(ani.scales().size());
+	header.translations_offset = Align(sizeof(header) + header.name_len, kRuntimeAlignment);
+	header.rotations_offset = Align(header.translations_offset + ani.translations().size_bytes(), kRuntimeAlignment);
+	header.scales_offset = Align(header.rotations_offset + ani.rotations().size_bytes(), kRuntimeAlignment);
+}
+
+// Tests that the keys array [offset, offset + count * size[ is aligned and fits
+// in the file.
+// Sampling starts with the first 2 keys of every track, SoA padding tracks
+// included, so shorter keys arrays can't be sampled.
+static bool __ValidKeyCounts(int32_t num_tracks, uint32_t translation_count, uint32_t rotation_count, uint32_t scale_count)
+{
+	const uint64_t min_keys = 2 * ((static_cast<uint64_t>(num_tracks) + 3) & ~uint64_t(3));
+	return num_tracks >= 0 &&
+		translation_count >= min_keys &&
+		rotation_count >= min_keys &&
+		scale_count >= min_keys;
+}
+
+static bool __ValidRuntimeArray(uint64_t offset, uint32_t count, size_t size, size_t file_size)
+{
+	return offset % kRuntimeAlignment == 0 &&
+		offset <= file_size &&
+		static_cast<uint64_t>(count) * size <= file_size - offset;
+}
+
+bool LoadFile::SaveRuntimeAnimation(const std::string& filename, const Animation& ani)
+{
+	RuntimeAnimationHeader header;
+	__FillRuntimeHeader(ani, header);
+
+	// Serializes the whole file in memory, padding included.
+	std::vector<byte> buffer(header.scales_offset + ani.scales().size_bytes(), 0);
+	memcpy(buffer.data(), &header, sizeof(header));
+	memcpy(buffer.data() + sizeof(header), ani.name().data(), header.name_len);
+	if (header.translation_count)
 	{
-		READ_IF_RETURN(binaryReader.read(&key.ratio, 1, sizeof(key.ratio)) != sizeof(key.ratio));
-		READ_IF_RETURN(binaryReader.read(&key.track, 1, sizeof(key.track)) != sizeof(key.track));
-		READ_IF_RETURN(binaryReader.read(&key.value, 1, sizeof(uint16_t) * 3) != sizeof(uint16_t) * 3);
+		memcpy(buffer.data() + header.translations_offset, ani.translations().data(), ani.translations().size_bytes());
 	}
-
-	for (QuaternionKey& key : outAni.rotations_)
+	if (header.rotation_count)
 	{
-		READ_IF_RETURN(binaryReader.read(&key.ratio, 1, sizeof(key.ratio)) != sizeof(key.ratio));
-		uint16_t track;
-		READ_IF_RETURN(binaryReader.read(&track, 1, sizeof(track)) != sizeof(track));
-		key.track = track;
-		uint8_t largest;
-		READ_IF_RETURN(binaryReader.read(&largest, 1, sizeof(largest)) != sizeof(largest));
-		key.largest = largest & 3;
-		bool sign;
-		READ_IF_RETURN(binaryReader.read(&sign, 1, sizeof(sign)) != sizeof(sign));
-		key.sign = sign & 1;
-		READ_IF_RETURN(binaryReader.read(&key.value, 1, sizeof(uint16_t) * 3) != sizeof(uint16_t) * 3);
+		memcpy(buffer.data() + header.rotations_offset, ani.rotations().data(), ani.rotations().size_bytes());
 	}
-
-	for (Float3Key& key : outAni.scales_)
+	if (header.scale_count)
 	{
-		READ_IF_RETURN(binaryReader.read(&key.ratio, 1, sizeof(key.ratio)) != sizeof(key.ratio));
-		READ_IF_RETURN(binaryReader.read(&key.track, 1, sizeof(key.track)) != sizeof(key.track));
-		READ_IF_RETURN(binaryReader.read(&key.value, 1, sizeof(uint16_t) * 3) != sizeof(uint16_t) * 3);
+		memcpy(buffer.data() + header.scales_offset, ani.scales().data(), ani.scales().size_bytes());
 	}
 
+	return NativeFile::WriteWholeFile(filename.c_str(), buffer.data(), buffer.size());
+}
+
+bool LoadFile::MapAnimation(const std::string& filename, Animation& outAni)
+{
+	std::unique_ptr<MappedFile> mapping(new MappedFile);
+	READ_IF_RETURN(!mapping->Open(filename.c_str()));
+
+	const byte* data = mapping->data();
+	const size_t size = mapping->size();
+	RuntimeAnimationHeader header;
+	READ_IF_RETURN(size < sizeof(header));
+	memcpy(&header, data, sizeof(header));
+
+	READ_IF_RETURN(memcmp(header.tag, kRuntimeAnimationTag, sizeof(header.tag)) != 0);
+	READ_IF_RETURN(header.version != kRuntimeAnimationVersion);
+	READ_IF_RETURN(!header.key_layout.IsNative());
+	READ_IF_RETURN(header.name_len > size - sizeof(header));
+	READ_IF_RETURN(!__ValidKeyCounts(header.num_tracks, header.translation_count, header.rotation_count, header.scale_count));
+	READ_IF_RETURN(!__ValidRuntimeArray(header.translations_offset, header.translation_count, sizeof(Float3Key), size));
+	READ_IF_RETURN(!__ValidRuntimeArray(header.rotations_offset, header.rotation_count, sizeof(QuaternionKey), size));
+	READ_IF_RETURN(!__ValidRuntimeArray(header.scales_offset, header.scale_count, sizeof(Float3Key), size));
+
+	// Mapping is page aligned, so are the arrays within.
+	span<const Float3Key> translations(reinterpret_cast<const Float3Key*>(data + header.translations_offset), header.translation_count);
+	span<const QuaternionKey> rotations(reinterpret_cast<const QuaternionKey*>(data + header.rotations_offset), header.rotation_count);
+	span<const Float3Key> scales(reinterpret_cast<const Float3Key*>(data + header.scales_offset), header.scale_count);
+
+	outAni.name_.assign(reinterpret_cast<const char*>(data + sizeof(header)), header.name_len);
+	outAni.duration_ = header.duration;
+	outAni.num_tracks_ = header.num_tracks;
+	outAni.Deallocate();
+	outAni.Adopt(std::move(mapping), translations, rotations, scales);
+
 	return true;
 }
 
-bool LoadFile::LoadAnimation(const std::string& filename, Animation& outAni)
+// Compressed animation format, see LoadFile::SaveCompressedAnimation.
+// Header is followed by the name, then by the translation, rotation and scale
+// keys streams encoded by KeyStreamCodec.
+struct CompressedAnimationHeader
 {
-	FILE* file = NULL;
-	fopen_s(&file, filename.c_str(), "rb");
-	if (file == NULL)
-		return false;
-
-	fseek(file, 0, SEEK_END);
-	int rawLength = ftell(file);
-	fseek(file, 0, SEEK_SET);
-	if (rawLength < 0)
-	{
-		fclose(file);
-		return false;
-	}
+	char tag[8];
+	uint32_t version;
+	float duration;
+	int32_t num_tracks;
+	uint32_t name_len;
+	uint32_t translation_count;
+	uint32_t rotation_count;
+	uint32_t scale_count;
+};
+
+static const char kCompressedAnimationTag[8] = "jy-anmz";
+static const uint32_t kCompressedAnimationVersion = 1;
+
+bool LoadFile::SaveCompressedAnimation(const std::string& filename, const Animation& ani)
+{
+	CompressedAnimationHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.tag, kCompressedAnimationTag, sizeof(header.tag));
+	header.version = kCompressedAnimationVersion;
+	header.duration = ani.Duration();
+	header.num_tracks = ani.num_tracks();
+	header.name_len = static_cast<uint32_t>(strlen(ani.name().c_str()));
+	header.translation_count = static_cast<uint32_t>(ani.translations().size());
+	header.rotation_count = static_cast<uint32_t>(ani.rotations().size());
+	header.scale_count = static_cast<uint32_t>(ani.scales().size());
+
+	std::vector<byte> buffer(sizeof(header) + header.name_len);
+	memcpy(buffer.data(), &header, sizeof(header));
+	memcpy(buffer.data() + sizeof(header), ani.name().data(), header.name_len);
+	READ_IF_RETURN(!KeyStreamCodec::Encode(ani.translations(), ani.num_tracks(), &buffer));
+	READ_IF_RETURN(!KeyStreamCodec::Encode(ani.rotations(), ani.num_tracks(), &buffer));
+	READ_IF_RETURN(!KeyStreamCodec::Encode(ani.scales(), ani.num_tracks(), &buffer));
+
+	return NativeFile::WriteWholeFile(filename.c_str(), buffer.data(), buffer.size());
+}
 
+bool LoadFile::LoadCompressedAnimation(const std::string& filename, Animation& outAni)
+{
 	std::string readTexts;
-	readTexts.resize(rawLength);
-	int readLength = fread(&*readTexts.begin(), 1, rawLength, file);
-	fclose(file);
+	READ_IF_RETURN(!NativeFile::ReadWholeFile(filename.c_str(), readTexts));
 
 	BundleReader binaryReader;
-	binaryReader.init((byte*)readTexts.data(), readTexts.size());
+	binaryReader.init(reinterpret_cast<const byte*>(readTexts.data()), readTexts.size());
+
+	CompressedAnimationHeader header;
+	READ_IF_RETURN(binaryReader.read(&header, 1, sizeof(header)) != sizeof(header));
+	READ_IF_RETURN(memcmp(header.tag, kCompressedAnimationTag, sizeof(header.tag)) != 0);
+	READ_IF_RETURN(header.version != kCompressedAnimationVersion);
+	READ_IF_RETURN(header.num_tracks < 0 || header.num_tracks > KeyStreamCodec::kMaxTracks);
+	const byte* name = binaryReader.readBytes(header.name_len);
+	READ_IF_RETURN(!name);
+	span<const byte> streams(binaryReader.readBytes(0), binaryReader.length() - binaryReader.tell());
+
+	// Validates keys count before allocating.
+	const uint64_t num_keys = static_cast<uint64_t>(header.translation_count) + header.rotation_count + header.scale_count;
+	READ_IF_RETURN(num_keys > streams.size() * static_cast<uint64_t>(KeyStreamCodec::kMaxKeysPerByte));
+	READ_IF_RETURN(!__ValidKeyCounts(header.num_tracks, header.translation_count, header.rotation_count, header.scale_count));
+
+	outAni.Allocate(header.translation_count, header.rotation_count, header.scale_count);
+	outAni.duration_ = header.duration;
+	outAni.num_tracks_ = header.num_tracks;
+	outAni.name_.assign(reinterpret_cast<const char*>(name), header.name_len);
+	READ_IF_RETURN(!KeyStreamCodec::Decode(&streams, header.num_tracks, make_span(outAni.translations_)));
+	READ_IF_RETURN(!KeyStreamCodec::Decode(&streams, header.num_tracks, make_span(outAni.rotations_)));
+	READ_IF_RETURN(!KeyStreamCodec::Decode(&streams, header.num_tracks, make_span(outAni.scales_)));
 
-	unsigned char endianness;
-	READ_IF_RETURN(binaryReader.read(&endianness, 1, 1) != 1);
+	return true;
+}
 
-	return _LoadAnimation(binaryReader, outAni);
+// Raw keys are stored as a time followed by the value. The key count is
+// checked against the remaining buffer before anything is allocated.
+template <typename _Key>
+static bool __LoadRawKeys(BundleReader& binaryReader, std::vector<_Key>& keys)
+{
+	unsigned int num;
+	READ_IF_RETURN(binaryReader.read(&num, 1, sizeof(num)) != sizeof(num));
+	unsigned int version;
+	READ_IF_RETURN(binaryReader.read(&version, 1, sizeof(version)) != sizeof(version));
+
+	const size_t stored_size = sizeof(float) + sizeof(typename _Key::Value);
+	const byte* src = binaryReader.readBytes(stored_size * num);
+	READ_IF_RETURN(!src);
+	keys.resize(num);
+	for (size_t i = 0; i < num; ++i, src += stored_size)
+	{
+		memcpy(&keys[i].time, src, sizeof(float));
+		memcpy(&keys[i].value, src + sizeof(float), sizeof(typename _Key::Value));
+	}
+	return true;
 }
 
 bool LoadFile::_LoadRawAnimation(BundleReader& binaryReader, RawAnimation& outAni)
@@ -273,87 +499,39 @@ bool LoadFile::_LoadRawAnimation(BundleReader& binaryReader, RawAnimation& outAn
 
 	unsigned int num_tracks;
 	READ_IF_RETURN(binaryReader.read(&num_tracks, 1, sizeof(num_tracks)) != sizeof(num_tracks));
-	outAni.tracks.reserve(num_tracks);
 
 	unsigned int JointTrackVersion;
 	READ_IF_RETURN(binaryReader.read(&JointTrackVersion, 1, sizeof(JointTrackVersion)) != sizeof(JointTrackVersion));
 	JY_ASSERT(JointTrackVersion == 1);
 
-	for (int i = 0; i < num_tracks; ++i)
+	// Every track stores at least the count and version of its 3 keys arrays.
+	READ_IF_RETURN(num_tracks > (binaryReader.length() - binaryReader.tell()) / (sizeof(unsigned int) * 6));
+	outAni.tracks.resize(num_tracks);
+	for (RawAnimation::JointTrack& track : outAni.tracks)
 	{
-		outAni.tracks.push_back(RawAnimation::JointTrack());
-
-		unsigned int num_trans;
-		READ_IF_RETURN(binaryReader.read(&num_trans, 1, sizeof(num_trans)) != sizeof(num_trans));
-		outAni.tracks.reserve(num_trans);
-		unsigned int TranslationKeyVersion;
-		READ_IF_RETURN(binaryReader.read(&TranslationKeyVersion, 1, sizeof(TranslationKeyVersion)) != sizeof(TranslationKeyVersion));
-		for (int j = 0; j < num_trans; ++j)
-		{
-			outAni.tracks[i].translations.push_back(RawAnimation::TranslationKey());
-			READ_IF_RETURN(binaryReader.read(&outAni.tracks[i].translations[j].time, 1, sizeof(float)) != sizeof(float));
-			READ_IF_RETURN(binaryReader.read(&outAni.tracks[i].translations[j].value, 1, sizeof(Math::Vec3)) != sizeof(Math::Vec3));
-		}
-
-		unsigned int num_rotate;
-		READ_IF_RETURN(binaryReader.read(&num_rotate, 1, sizeof(num_rotate)) != sizeof(num_rotate));
-		outAni.tracks.reserve(num_rotate);
-		unsigned int RotateKeyVersion;
-		READ_IF_RETURN(binaryReader.read(&RotateKeyVersion, 1, sizeof(RotateKeyVersion)) != sizeof(RotateKeyVersion));
-		for (int j = 0; j < num_rotate; ++j)
-		{
-			outAni.tracks[i].rotations.push_back(RawAnimation::RotationKey());
-			READ_IF_RETURN(binaryReader.read(&outAni.tracks[i].rotations[j].time, 1, sizeof(float)) != sizeof(float));
-			READ_IF_RETURN(binaryReader.read(&outAni.tracks[i].rotations[j].value, 1, sizeof(Math::Quaternion)) != sizeof(Math::Quaternion));
-		}
-
-		unsigned int num_scale;
-		READ_IF_RETURN(binaryReader.read(&num_scale, 1, sizeof(num_scale)) != sizeof(num_scale));
-		outAni.tracks.reserve(num_scale);
-		unsigned int ScaleKeyVersion;
-		READ_IF_RETURN(binaryReader.read(&ScaleKeyVersion, 1, sizeof(ScaleKeyVersion)) != sizeof(ScaleKeyVersion));
-		for (int j = 0; j < num_scale; ++j)
-		{
-			outAni.tracks[i].scales.push_back(RawAnimation::ScaleKey());
-			READ_IF_RETURN(binaryReader.read(&outAni.tracks[i].scales[j].time, 1, sizeof(float)) != sizeof(float));
-			READ_IF_RETURN(binaryReader.read(&outAni.tracks[i].scales[j].value, 1, sizeof(Math::Vec3)) != sizeof(Math::Vec3));
-		}
+		READ_IF_RETURN(!__LoadRawKeys(binaryReader, track.translations));
+		READ_IF_RETURN(!__LoadRawKeys(binaryReader, track.rotations));
+		READ_IF_RETURN(!__LoadRawKeys(binaryReader, track.scales));
 	}
 
 	//READ_IF_RETURN(binaryReader.read(&outAni.duration, 1, sizeof(outAni.duration)) != sizeof(outAni.duration));
 	unsigned int ani_name_size;
 	READ_IF_RETURN(binaryReader.read(&ani_name_size, 1, sizeof(ani_name_size)) != sizeof(ani_name_size));
-	char ani_name[32] = {};
-	READ_IF_RETURN(binaryReader.read(ani_name, 1, ani_name_size) != ani_name_size);
-	outAni.name = ani_name;
+	const char* ani_name = reinterpret_cast<const char*>(binaryReader.readBytes(ani_name_size));
+	READ_IF_RETURN(!ani_name);
+	// Name stops at the first null terminator, if any.
+	outAni.name.assign(ani_name, std::find(ani_name, ani_name + ani_name_size, '\0'));
 
 	return true;
 }
 
 bool LoadFile::LoadRawAnimation(const std::string& filename, RawAnimation& outAni)
 {
-	FILE* file = NULL;
-	fopen_s(&file, filename.c_str(), "rb");
-	if (file == NULL)
-		return false;
-
-	fseek(file, 0, SEEK_END);
-	int rawLength = ftell(file);
-	fseek(file, 0, SEEK_SET);
-	if (rawLength < 0)
-	{
-		fclose(file);
-		return false;
-	}
-
 	std::string readTexts;
-	readTexts.resize(rawLength);
-	int readLength = fread((char*)readTexts.data(), 1, rawLength, file);
-	bool bf = feof(file);
-	fclose(file);
+	READ_IF_RETURN(!NativeFile::ReadWholeFile(filename.c_str(), readTexts));
 
 	BundleReader binaryReader;
-	binaryReader.init((byte*)readTexts.data(), readTexts.size());
+	binaryReader.init(reinterpret_cast<const byte*>(readTexts.data()), readTexts.size());
 
 	unsigned char endianness;
 	READ_IF_RETURN(binaryReader.read(&endianness, 1, 1) != 1);
@@ -366,8 +544,14 @@ static bool __LoadMeshData(BundleReader& binaryReader, std::vector<T>& data, int
 {
 	unsigned int num;
 	READ_IF_RETURN(binaryReader.read(&num, 1, sizeof(num)) != sizeof(num));
+	// Checks the count before allocating anything.
+	const byte* src = binaryReader.readBytes(sizeof(T) * num);
+	READ_IF_RETURN(!src);
 	data.resize(num);
-	READ_IF_RETURN(binaryReader.read(data.data(), 1, sizeof(T) * num) != sizeof(T) * num);
+	if (num)
+	{
+		memcpy(data.data(), src, sizeof(T) * num);
+	}
 	return true;
 }
 
@@ -381,13 +565,15 @@ static bool __LoadMesh(BundleReader& binaryReader, Mesh& outMesh)
 
 	unsigned int mesh_version;
 	READ_IF_RETURN(binaryReader.read(&mesh_version, 1, sizeof(mesh_version)) != sizeof(mesh_version));
-	JY_ASSERT(mesh_version == 1);
+	JY_ASSERT(mesh_version == 1 || mesh_version == 2);
 
 	unsigned int num_part;
 	READ_IF_RETURN(binaryReader.read(&num_part, 1, sizeof(num_part)) != sizeof(num_part));
 
 	if (num_part > 0)
 	{
+		// Every part stores at least its 7 arrays sizes.
+		READ_IF_RETURN(num_part > (binaryReader.length() - binaryReader.tell()) / (sizeof(unsigned int) * 7));
 		outMesh.parts.resize(num_part);
 
 		unsigned int part_version;
@@ -396,56 +582,120 @@ static bool __LoadMesh(BundleReader& binaryReader, Mesh& outMesh)
 
 		for (int i = 0; i < num_part; ++i)
 		{
-			__LoadMeshData(binaryReader, outMesh.parts[i].positions, Mesh::Part::kPositionsCpnts);
-			__LoadMeshData(binaryReader, outMesh.parts[i].normals, Mesh::Part::kNormalsCpnts);
-			__LoadMeshData(binaryReader, outMesh.parts[i].tangents, Mesh::Part::kTangentsCpnts);
-			__LoadMeshData(binaryReader, outMesh.parts[i].uvs, Mesh::Part::kUVsCpnts);
-			__LoadMeshData(binaryReader, outMesh.parts[i].colors, Mesh::Part::kColorsCpnts);
-			__LoadMeshData(binaryReader, outMesh.parts[i].joint_indices, 4);
-			__LoadMeshData(binaryReader, outMesh.parts[i].joint_weights, 4);
+			READ_IF_RETURN(!__LoadMeshData(binaryReader, outMesh.parts[i].positions, Mesh::Part::kPositionsCpnts));
+			READ_IF_RETURN(!__LoadMeshData(binaryReader, outMesh.parts[i].normals, Mesh::Part::kNormalsCpnts));
+			READ_IF_RETURN(!__LoadMeshData(binaryReader, outMesh.parts[i].tangents, Mesh::Part::kTangentsCpnts));
+			READ_IF_RETURN(!__LoadMeshData(binaryReader, outMesh.parts[i].uvs, Mesh::Part::kUVsCpnts));
+			READ_IF_RETURN(!__LoadMeshData(binaryReader, outMesh.parts[i].colors, Mesh::Part::kColorsCpnts));
+			READ_IF_RETURN(!__LoadMeshData(binaryReader, outMesh.parts[i].joint_indices, 4));
+			READ_IF_RETURN(!__LoadMeshData(binaryReader, outMesh.parts[i].joint_weights, 4));
 		}
 	}
 
-	__LoadMeshData(binaryReader, outMesh.triangle_indices, 0);
-	__LoadMeshData(binaryReader, outMesh.joint_remaps, 0);
-	__LoadMeshData(binaryReader, outMesh.inverse_bind_poses, 0);
+	READ_IF_RETURN(!__LoadMeshData(binaryReader, outMesh.triangle_indices, 0));
+	READ_IF_RETURN(!__LoadMeshData(binaryReader, outMesh.joint_remaps, 0));
+	READ_IF_RETURN(!__LoadMeshData(binaryReader, outMesh.inverse_bind_poses, 0));
+
+	// Version 2 appends morph targets.
+	if (mesh_version >= 2)
+	{
+		unsigned int num_target;
+		READ_IF_RETURN(binaryReader.read(&num_target, 1, sizeof(num_target)) != sizeof(num_target));
+		// Every target stores at least its name length and 3 arrays sizes.
+		READ_IF_RETURN(num_target > (binaryReader.length() - binaryReader.tell()) / (sizeof(unsigned int) * 4));
+		outMesh.morph_targets.resize(num_target);
+		for (Mesh::MorphTarget& target : outMesh.morph_targets)
+		{
+			span<const char> name;
+			READ_IF_RETURN(!binaryReader.readStringView(&name));
+			target.name.assign(name.begin(), std::find(name.begin(), name.end(), '\0'));
+
+			READ_IF_RETURN(!__LoadMeshData(binaryReader, target.indices, 1));
+			READ_IF_RETURN(!__LoadMeshData(binaryReader, target.position_deltas, 3));
+			READ_IF_RETURN(!__LoadMeshData(binaryReader, target.normal_deltas, 3));
+
+			// MorphJob binary searches indices, and expects 3 deltas per index.
+			READ_IF_RETURN(std::adjacent_find(target.indices.begin(), target.indices.end(), std::greater_equal<uint16_t>()) != target.indices.end());
+			READ_IF_RETURN(target.position_deltas.size() != target.indices.size() * 3);
+			READ_IF_RETURN(!target.normal_deltas.empty() && target.normal_deltas.size() != target.indices.size() * 3);
+		}
+	}
 
 	return true;
 }
 
-bool LoadFile::LoadMesh(const std::string& filename, std::vector<Mesh>& outMeshes)
+bool LoadFile::LoadMesh(const std::string& filename, std::vector<Mesh>& outMeshes, bool quantize)
 {
-	FILE* file = NULL;
-	fopen_s(&file, filename.c_str(), "rb");
-	if (file == NULL)
-		return false;
-
-	fseek(file, 0, SEEK_END);
-	int rawLength = ftell(file);
-	fseek(file, 0, SEEK_SET);
-	if (rawLength < 0)
-	{
-		fclose(file);
-		return false;
-	}
-
-	std::string readTexts;
-	readTexts.resize(rawLength);
-	int readLength = fread((char*)readTexts.data(), 1, rawLength, file);
-	bool bf = feof(file);
-	fclose(file);
+	// Mesh data is copied once, from the mapping to the meshes.
+	MappedFile mapping;
+	READ_IF_RETURN(!mapping.Open(filename.c_str()));
 
 	BundleReader binaryReader;
-	binaryReader.init((byte*)readTexts.data(), readTexts.size());
+	binaryReader.init(mapping.data(), mapping.size());
 
 	unsigned char endianness;
 	READ_IF_RETURN(binaryReader.read(&endianness, 1, 1) != 1);
 
+	return _LoadMesh(binaryReader, outMeshes, quantize);
+}
+
+bool LoadFile::_LoadMesh(BundleReader& binaryReader, std::vector<Mesh>& outMeshes, bool quantize)
+{
 	while (!binaryReader.eof())
 	{
 		outMeshes.resize(outMeshes.size() + 1);
-		__LoadMesh(binaryReader, outMeshes[outMeshes.size()-1]);
+		if (!__LoadMesh(binaryReader, outMeshes.back()))
+		{
+			// Drops the partially read mesh.
+			outMeshes.pop_back();
+			return false;
+		}
+		if (quantize)
+		{
+			outMeshes.back().Quantize();
+		}
 	}
 
 	return true;
 }
+
+// Archive entries are whole asset files, so they are loaded the same way once
+// located.
+static bool __InitArchiveReader(const Archive& archive, const std::string& name, BundleReader& binaryReader)
+{
+	const span<const byte> entry = archive.Find(name);
+	READ_IF_RETURN(entry.empty());
+	binaryReader.init(entry.data(), entry.size());
+
+	unsigned char endianness;
+	READ_IF_RETURN(binaryReader.read(&endianness, 1, 1) != 1);
+	return true;
+}
+
+bool LoadFile::LoadSkeleton(const Archive& archive, const std::string& name, Skeleton& outSke)
+{
+	BundleReader binaryReader;
+	READ_IF_RETURN(!__InitArchiveReader(archive, name, binaryReader));
+	return _LoadSkeleton(binaryReader, outSke);
+}
+
+bool LoadFile::LoadAnimation(const Archive& archive, const std::string& name, Animation& outAni)
+{
+	BundleReader binaryReader;
+	READ_IF_RETURN(!__InitArchiveReader(archive, name, binaryReader));
+	return _LoadAnimation(binaryReader, outAni);
+}
+
+bool LoadFile::LoadRawAnimation(const Archive& archive, const std::string& name, RawAnimation& outAni)
+{
+	BundleReader binaryReader;
+	READ_IF_RETURN(!__InitArchiveReader(archive, name, binaryReader));
+	return _LoadRawAnimation(binaryReader, outAni);
+}
+
+bool LoadFile::LoadMesh(const Archive& archive, const std::string& name, std::vector<Mesh>& outMeshes, bool quantize)
+{
+	BundleReader binaryReader;
+	READ_IF_RETURN(!__InitArchiveReader(archive, name, binaryReader));
+	return _LoadMesh(binaryReader, outMeshes, quantize);
+}
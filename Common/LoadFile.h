@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -9,15 +10,41 @@ class RawAnimation;
 class Mesh;
 
 class BundleReader;
+class Archive;
 
 class LoadFile
 {
 public:
 	static bool LoadSkeleton(const std::string& filename, Skeleton& outSke);
+	// The file is mapped, translation and scale keys are views into the
+	// mapping when they're suitably aligned in the file, and copied otherwise.
 	static bool LoadAnimation(const std::string& filename, Animation& outAni);
+	// Runtime animation format: keys are stored aligned, in their in-memory
+	// layout, so that MapAnimation can map the file and have the animation
+	// reference keys in place, without reading nor copying them. The format is
+	// platform specific, files are built from a loaded animation with
+	// SaveRuntimeAnimation. The mapping lives as long as the animation.
+	static bool SaveRuntimeAnimation(const std::string& filename, const Animation& ani);
+	static bool MapAnimation(const std::string& filename, Animation& outAni);
+	// Compressed animation format, keys are losslessly compressed with
+	// KeyStreamCodec to reduce file size and I/O time.
+	static bool SaveCompressedAnimation(const std::string& filename, const Animation& ani);
+	static bool LoadCompressedAnimation(const std::string& filename, Animation& outAni);
 	static bool LoadRawAnimation(const std::string& filename, RawAnimation& outAni);
-	static bool LoadMesh(const std::string& filename, std::vector<Mesh>& outAni);
+	// If quantize is true, Mesh::quantized_parts are built for every mesh.
+	static bool LoadMesh(const std::string& filename, std::vector<Mesh>& outAni, bool quantize = false);
+
+	// Loads the entry name of an archive, see Archive. Entries are the asset
+	// files above, packed together.
+	static bool LoadSkeleton(const Archive& archive, const std::string& name, Skeleton& outSke);
+	static bool LoadAnimation(const Archive& archive, const std::string& name, Animation& outAni);
+	static bool LoadRawAnimation(const Archive& archive, const std::string& name, RawAnimation& outAni);
+	static bool LoadMesh(const Archive& archive, const std::string& name, std::vector<Mesh>& outAni, bool quantize = false);
 private:
-	static bool _LoadAnimation(BundleReader& binaryReader, Animation& outAni);
+	static bool _LoadSkeleton(BundleReader& binaryReader, Skeleton& outSke);
+	// If storage isn't null, it owns the reader's buffer, which the animation
+	// can then keep views into.
+	static bool _LoadAnimation(BundleReader& binaryReader, Animation& outAni, const std::shared_ptr<const void>& storage = nullptr);
 	static bool _LoadRawAnimation(BundleReader& binaryReader, RawAnimation& outAni);
+	static bool _LoadMesh(BundleReader& binaryReader, std::vector<Mesh>& outAni, bool quantize);
 };
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "LocalToModelJob.h"
 #include "../Math/3DMath.h"
+#include "../Math/SimdMath.h"
 #include "Skeleton.h"
+#include "SimdAffine.h"
 
 LocalToModelJob::LocalToModelJob()
 	: skeleton(nullptr),
@@ -16,7 +18,7 @@ bool LocalToModelJob::Validate() const
 	// Tests are written in multiple lines in order to avoid branches.
 	bool valid = true;
 
-	if (!skeleton) 
+	if (!skeleton)
 	{
 		return false;
 	}
@@ -24,38 +26,586 @@ bool LocalToModelJob::Validate() const
 	const size_t num_joints = static_cast<size_t>(skeleton->num_joints());
 
 	valid &= input.size() >= num_joints;
-	valid &= output.size() >= num_joints;
+	if (!affine_output.empty())
+	{
+		valid &= affine_output.size() >= num_joints;
+	}
+	else
+	{
+		valid &= output.size() >= num_joints;
+	}
 
 	return valid;
 }
 
+namespace
+{
+#if MATH_SIMD_SSE2
+	using Math::SimdFloat4;
+	using internal::BuildSoaAffine;
+	using internal::Mat4Traits;
+
+	// Mat3x4 output. Matrices are processed as their 3 transposed rows, so that
+	// model^T = parent^T * local^T. The 4th row of transposed affine matrices is
+	// the constant (0, 0, 0, 1) and is never loaded nor stored.
+	struct Mat3x4Traits
+	{
+		typedef Math::Mat3x4 Matrix;
+
+		// Transposes soa components to per-joint transposed local matrix rows.
+		static void Locals(SimdFloat4 _m[12], SimdFloat4 _locals[4][4])
+		{
+			SimdFloat4 r0[4] = { _m[0], _m[3], _m[6], _m[9] };
+			SimdFloat4 r1[4] = { _m[1], _m[4], _m[7], _m[10] };
+			SimdFloat4 r2[4] = { _m[2], _m[5], _m[8], _m[11] };
+			SimdFloat4* rows[3] = { r0, r1, r2 };
+			for (int r = 0; r < 3; ++r)
+			{
+				Math::simd::Transpose4x4(rows[r][0], rows[r][1], rows[r][2], rows[r][3]);
+				for (int j = 0; j < 4; ++j)
+				{
+					_locals[j][r] = rows[r][j];
+				}
+			}
+		}
+
+		static void Load(const Matrix& _matrix, SimdFloat4 _rows[4])
+		{
+			_rows[0] = Math::simd::LoadPtrU(_matrix.m + 0);
+			_rows[1] = Math::simd::LoadPtrU(_matrix.m + 4);
+			_rows[2] = Math::simd::LoadPtrU(_matrix.m + 8);
+		}
+
+		static void MultiplyStore(const SimdFloat4 _local[4], const SimdFloat4 _parent[4], Matrix* _output)
+		{
+			using Math::simd::MAdd;
+			using Math::simd::Splat;
+			for (int r = 0; r < 3; ++r)
+			{
+				const SimdFloat4 row = _mm_add_ps(
+					MAdd(Splat<2>(_parent[r]), _local[2],
+						MAdd(Splat<1>(_parent[r]), _local[1],
+							_mm_mul_ps(Splat<0>(_parent[r]), _local[0]))),
+					Math::simd::KeepW(_parent[r]));
+				Math::simd::StorePtrU(row, _output->m + r * 4);
+			}
+		}
+	};
+
+	// Converts 4 joints per iteration: local matrices are built in SoA, then
+	// each joint is concatenated to its parent with affine SIMD multiplies.
+	template <typename _Traits>
+	void LocalToModel(const LocalToModelJob& _job, span<typename _Traits::Matrix> _output)
+	{
+		typedef typename _Traits::Matrix Matrix;
+
+		const std::vector<int16_t>& parents = _job.skeleton->joint_parents();
+		const int num_joints = _job.skeleton->num_joints();
+
+		// Converts the root matrix once, so roots don't require a branch.
+		const Matrix root_matrix(_job.root == nullptr ? Math::Mat4::IDENTITY : *_job.root);
+
+		// Loop ends after "to".
+		const int end = Math::Min(_job.to + 1, num_joints);
+
+		// Begins iteration from "from", or the next joint if "from" is excluded.
+		// Process next joint if end is not reach. parents[begin] >= from is true as
+		// long as "begin" is a child of "from".
+		for (int i = Math::Max(_job.from + _job.from_excluded, 0),
+			process = i < end && (!_job.from_excluded || parents[i] >= _job.from);
+			process;)
+		{
+			// Builds local matrices for the next 4 joints. Indices are clamped to
+			// the last joint so the input buffer is never overrun, the extra
+			// matrices are simply not used.
+			const Math::Transform* transforms[4];
+			for (int k = 0; k < 4; ++k)
+			{
+				transforms[k] = &_job.input[Math::Min(i + k, num_joints - 1)];
+			}
+			SimdFloat4 soa[12];
+			BuildSoaAffine(transforms, soa);
+			SimdFloat4 locals[4][4];
+			_Traits::Locals(soa, locals);
+
+			// parents[i] >= from is true as long as "i" is a child of "from".
+			for (int k = 0; k < 4 && process;
+				++k, ++i, process = i < end && parents[i] >= _job.from)
+			{
+				const int parent = parents[i];
+				const Matrix& parent_matrix =
+					parent == Skeleton::kNoParent ? root_matrix : _output[parent];
+				SimdFloat4 parent_rows[4];
+				_Traits::Load(parent_matrix, parent_rows);
+				_Traits::MultiplyStore(locals[k], parent_rows, &_output[i]);
+			}
+		}
+	}
+#else  // MATH_SIMD_SSE2
+	// Scalar fallback, using full Mat4 multiplications.
+	struct Mat4Traits
+	{
+		typedef Math::Mat4 Matrix;
+		static Math::Mat4 Load(const Matrix& _matrix) { return _matrix; }
+		static void Store(const Math::Mat4& _matrix, Matrix* _output) { *_output = _matrix; }
+	};
+
+	struct Mat3x4Traits
+	{
+		typedef Math::Mat3x4 Matrix;
+		static Math::Mat4 Load(const Matrix& _matrix) { return _matrix.ToMat4(); }
+		static void Store(const Math::Mat4& _matrix, Matrix* _output) { *_output = Matrix(_matrix); }
+	};
+
+	template <typename _Traits>
+	void LocalToModel(const LocalToModelJob& _job, span<typename _Traits::Matrix> _output)
+	{
+		typedef typename _Traits::Matrix Matrix;
+
+		const std::vector<int16_t>& parents = _job.skeleton->joint_parents();
+
+		const Matrix root_matrix(_job.root == nullptr ? Math::Mat4::IDENTITY : *_job.root);
+
+		// Loop ends after "to".
+		const int end = Math::Min(_job.to + 1, _job.skeleton->num_joints());
+
+		// Begins iteration from "from", or the next joint if "from" is excluded.
+		// Process next joint if end is not reach. parents[begin] >= from is true as
+		// long as "begin" is a child of "from".
+		for (int i = Math::Max(_job.from + _job.from_excluded, 0),
+			process = i < end && (!_job.from_excluded || parents[i] >= _job.from);
+			process; ++i, process = i < end && parents[i] >= _job.from)
+		{
+			// Builds matrices from local transforms.
+			const Math::Transform& transform = _job.input[i];
+			const Math::Mat4 local_aos_matrices = Math::MathUtil::Transformation(
+				transform.m_scale, transform.m_rotation, transform.m_translation);
+
+			const int parent = parents[i];
+			const Matrix& parent_matrix =
+				parent == Skeleton::kNoParent ? root_matrix : _output[parent];
+			_Traits::Store(local_aos_matrices * _Traits::Load(parent_matrix), &_output[i]);
+		}
+	}
+#endif  // MATH_SIMD_SSE2
+}  // namespace
+
 bool LocalToModelJob::Run() const
 {
 	if (!Validate()) {
 		return false;
 	}
 
-	const std::vector<int16_t>& parents = skeleton->joint_parents();
+	static_assert(Skeleton::kNoParent < 0,
+		"Algorithm relies on kNoParent being negative");
+
+	if (!affine_output.empty())
+	{
+		LocalToModel<Mat3x4Traits>(*this, affine_output);
+	}
+	else
+	{
+		LocalToModel<Mat4Traits>(*this, output);
+	}
+
+	return true;
+}
+
+LocalToModelBatchJob::LocalToModelBatchJob()
+	: skeleton(nullptr) {}
+
+bool LocalToModelBatchJob::Validate() const
+{
+	bool valid = true;
+
+	if (!skeleton)
+	{
+		return false;
+	}
+
+	const size_t num_joints = static_cast<size_t>(skeleton->num_joints());
+	const size_t num_instances = inputs.size();
 
-	// Initializes an identity matrix that will be used to compute roots model
-	// matrices without requiring a branch.
-	const Math::Mat4 identity = Math::Mat4::IDENTITY;
-	const Math::Mat4* root_matrix = (root == nullptr) ? &identity : root;
+	valid &= roots.empty() || roots.size() >= num_instances;
 
-	const int end = Math::Min(to + 1, skeleton->num_joints());
-	for (int i = 0; i < parents.size(); ++i) 
+	for (const span<const Math::Transform>& input : inputs)
 	{
-		// Builds soa matrices from soa transforms.
-		const Math::Transform& transform = input[i];
-		const Math::Mat4 local_aos_matrices = Math::MathUtil::Transformation(
-			transform.m_scale, transform.m_rotation, transform.m_translation);
+		valid &= input.size() >= num_joints;
+	}
 
-		// parents[i] >= from is true as long as "i" is a child of "from".
-		const int parent = parents[i];
-		const Math::Mat4* parent_matrix =
-			parent == Skeleton::kNoParent ? root_matrix : &output[parent];
-		output[i] = local_aos_matrices  * (*parent_matrix);
+	if (!affine_outputs.empty())
+	{
+		valid &= affine_outputs.size() == num_instances;
+		for (const span<Math::Mat3x4>& output : affine_outputs)
+		{
+			valid &= output.size() >= num_joints;
+		}
+	}
+	else
+	{
+		valid &= outputs.size() == num_instances;
+		for (const span<Math::Mat4>& output : outputs)
+		{
+			valid &= output.size() >= num_joints;
+		}
 	}
 
+	return valid;
+}
+
+namespace
+{
+#if MATH_SIMD_SSE2
+	// Soa affine matrices store the 12 meaningful components of 4 matrices, in
+	// the order used by BuildSoaAffine: a11 a12 a13 a21 a22 a23 a31 a32 a33 a41
+	// a42 a43. Lane j of every register belongs to the same instance.
+
+	// Computes _local * _parent for 4 instances. There's no shuffle at all, every
+	// instance lives in its own lane.
+	void MultiplySoaAffine(const SimdFloat4 _local[12], const SimdFloat4 _parent[12], SimdFloat4 _output[12])
+	{
+		using Math::simd::MAdd;
+		for (int r = 0; r < 4; ++r)
+		{
+			const SimdFloat4* l = _local + r * 3;
+			for (int c = 0; c < 3; ++c)
+			{
+				_output[r * 3 + c] =
+					MAdd(l[2], _parent[6 + c],
+						MAdd(l[1], _parent[3 + c], _mm_mul_ps(l[0], _parent[c])));
+			}
+		}
+		_output[9] = _mm_add_ps(_output[9], _parent[9]);
+		_output[10] = _mm_add_ps(_output[10], _parent[10]);
+		_output[11] = _mm_add_ps(_output[11], _parent[11]);
+	}
+
+	struct SoaMat4Traits
+	{
+		typedef Math::Mat4 Matrix;
+
+		// Loads 4 matrices to soa, one per lane.
+		static void LoadSoa(const Matrix* const _matrices[4], SimdFloat4 _soa[12])
+		{
+			for (int r = 0; r < 4; ++r)
+			{
+				SimdFloat4 a = Math::simd::LoadPtrU(_matrices[0]->m + r * 4);
+				SimdFloat4 b = Math::simd::LoadPtrU(_matrices[1]->m + r * 4);
+				SimdFloat4 c = Math::simd::LoadPtrU(_matrices[2]->m + r * 4);
+				SimdFloat4 d = Math::simd::LoadPtrU(_matrices[3]->m + r * 4);
+				Math::simd::Transpose4x4(a, b, c, d);
+				_soa[r * 3 + 0] = a;
+				_soa[r * 3 + 1] = b;
+				_soa[r * 3 + 2] = c;
+			}
+		}
+
+		// Stores the first _count lanes of _soa, restoring the constant column.
+		static void StoreSoa(const SimdFloat4 _soa[12], Matrix* const _matrices[4], int _count)
+		{
+			for (int r = 0; r < 4; ++r)
+			{
+				SimdFloat4 rows[4] = { _soa[r * 3 + 0], _soa[r * 3 + 1], _soa[r * 3 + 2],
+					r == 3 ? Math::simd::One() : Math::simd::Zero() };
+				Math::simd::Transpose4x4(rows[0], rows[1], rows[2], rows[3]);
+				for (int j = 0; j < _count; ++j)
+				{
+					Math::simd::StorePtrU(rows[j], _matrices[j]->m + r * 4);
+				}
+			}
+		}
+	};
+
+	struct SoaMat3x4Traits
+	{
+		typedef Math::Mat3x4 Matrix;
+
+		static void LoadSoa(const Matrix* const _matrices[4], SimdFloat4 _soa[12])
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				SimdFloat4 a = Math::simd::LoadPtrU(_matrices[0]->m + c * 4);
+				SimdFloat4 b = Math::simd::LoadPtrU(_matrices[1]->m + c * 4);
+				SimdFloat4 d = Math::simd::LoadPtrU(_matrices[2]->m + c * 4);
+				SimdFloat4 e = Math::simd::LoadPtrU(_matrices[3]->m + c * 4);
+				Math::simd::Transpose4x4(a, b, d, e);
+				_soa[0 + c] = a;
+				_soa[3 + c] = b;
+				_soa[6 + c] = d;
+				_soa[9 + c] = e;
+			}
+		}
+
+		static void StoreSoa(const SimdFloat4 _soa[12], Matrix* const _matrices[4], int _count)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				SimdFloat4 rows[4] = { _soa[0 + c], _soa[3 + c], _soa[6 + c], _soa[9 + c] };
+				Math::simd::Transpose4x4(rows[0], rows[1], rows[2], rows[3]);
+				for (int j = 0; j < _count; ++j)
+				{
+					Math::simd::StorePtrU(rows[j], _matrices[j]->m + c * 4);
+				}
+			}
+		}
+	};
+
+	template <typename _Traits>
+	void LocalToModelBatch(const LocalToModelBatchJob& _job, span<const span<typename _Traits::Matrix>> _outputs)
+	{
+		typedef typename _Traits::Matrix Matrix;
+
+		const std::vector<int16_t>& parents = _job.skeleton->joint_parents();
+		const int num_joints = _job.skeleton->num_joints();
+		const int num_instances = static_cast<int>(_job.inputs.size());
+
+		for (int g = 0; g < num_instances; g += 4)
+		{
+			// Lanes beyond the last instance duplicate it, they are computed but
+			// never stored.
+			const int count = Math::Min(num_instances - g, 4);
+			int lanes[4];
+			for (int j = 0; j < 4; ++j)
+			{
+				lanes[j] = g + Math::Min(j, count - 1);
+			}
+
+			// Root matrices of this group, loaded once.
+			const Math::Mat4* roots[4];
+			for (int j = 0; j < 4; ++j)
+			{
+				roots[j] = _job.roots.empty() ? &Math::Mat4::IDENTITY : &_job.roots[lanes[j]];
+			}
+			SimdFloat4 root_soa[12];
+			SoaMat4Traits::LoadSoa(roots, root_soa);
+
+			for (int i = 0; i < num_joints; ++i)
+			{
+				const Math::Transform* transforms[4];
+				for (int j = 0; j < 4; ++j)
+				{
+					transforms[j] = &_job.inputs[lanes[j]][i];
+				}
+				SimdFloat4 local_soa[12];
+				BuildSoaAffine(transforms, local_soa);
+
+				// The parent lookup and branch are shared by all the lanes.
+				const int parent = parents[i];
+				SimdFloat4 parent_soa[12];
+				const SimdFloat4* parent_ptr = root_soa;
+				if (parent != Skeleton::kNoParent)
+				{
+					const Matrix* parent_matrices[4];
+					for (int j = 0; j < 4; ++j)
+					{
+						parent_matrices[j] = &_outputs[lanes[j]][parent];
+					}
+					_Traits::LoadSoa(parent_matrices, parent_soa);
+					parent_ptr = parent_soa;
+				}
+
+				SimdFloat4 model_soa[12];
+				MultiplySoaAffine(local_soa, parent_ptr, model_soa);
+
+				Matrix* model_matrices[4];
+				for (int j = 0; j < 4; ++j)
+				{
+					model_matrices[j] = &_outputs[lanes[j]][i];
+				}
+				_Traits::StoreSoa(model_soa, model_matrices, count);
+			}
+		}
+	}
+#endif  // MATH_SIMD_SSE2
+}  // namespace
+
+bool LocalToModelBatchJob::Run() const
+{
+	if (!Validate()) {
+		return false;
+	}
+
+#if MATH_SIMD_SSE2
+	if (!affine_outputs.empty())
+	{
+		LocalToModelBatch<SoaMat3x4Traits>(*this, affine_outputs);
+	}
+	else
+	{
+		LocalToModelBatch<SoaMat4Traits>(*this, outputs);
+	}
+#else  // MATH_SIMD_SSE2
+	// Scalar fallback, instances are processed one after the other.
+	for (size_t i = 0; i < inputs.size(); ++i)
+	{
+		LocalToModelJob job;
+		job.skeleton = skeleton;
+		job.root = roots.empty() ? nullptr : &roots[i];
+		job.input = inputs[i];
+		if (!affine_outputs.empty())
+		{
+			job.affine_output = affine_outputs[i];
+		}
+		else
+		{
+			job.output = outputs[i];
+		}
+		job.Run();
+	}
+#endif  // MATH_SIMD_SSE2
+
 	return true;
-}
\ No newline at end of file
+}
+
+LocalToModelLevelJob::LocalToModelLevelJob()
+	: skeleton(nullptr),
+	root(nullptr),
+	level_begin(0),
+	level_end(Skeleton::kMaxJoints),
+	partition(0),
+	num_partitions(1) {}
+
+bool LocalToModelLevelJob::Validate() const
+{
+	bool valid = true;
+
+	if (!skeleton)
+	{
+		return false;
+	}
+
+	const size_t num_joints = static_cast<size_t>(skeleton->num_joints());
+
+	valid &= input.size() >= num_joints;
+	if (!affine_output.empty())
+	{
+		valid &= affine_output.size() >= num_joints;
+	}
+	else
+	{
+		valid &= output.size() >= num_joints;
+	}
+
+	valid &= level_begin >= 0;
+	valid &= partition >= 0 && partition < num_partitions;
+	valid &= num_partitions == 1 || level_end - level_begin == 1;
+
+	return valid;
+}
+
+namespace
+{
+	// Returns the range of level_joints() of _level processed by _job.
+	Skeleton::JointRange PartitionRange(const LocalToModelLevelJob& _job, int _level)
+	{
+		const Skeleton::JointRange level = _job.skeleton->level_range(_level);
+		const int count = level.end - level.begin;
+		const Skeleton::JointRange range = {
+			static_cast<int16_t>(level.begin + count * _job.partition / _job.num_partitions),
+			static_cast<int16_t>(level.begin + count * (_job.partition + 1) / _job.num_partitions) };
+		return range;
+	}
+
+#if MATH_SIMD_SSE2
+	// Lanes are 4 joints of a same level, gathered with their parents.
+	template <typename _Traits>
+	void LocalToModelLevels(const LocalToModelLevelJob& _job, span<typename _Traits::Matrix> _output)
+	{
+		typedef typename _Traits::Matrix Matrix;
+
+		const std::vector<int16_t>& parents = _job.skeleton->joint_parents();
+		const std::vector<int16_t>& joints = _job.skeleton->level_joints();
+
+		const Matrix root_matrix(_job.root == nullptr ? Math::Mat4::IDENTITY : *_job.root);
+
+		const int level_end = Math::Min(_job.level_end, _job.skeleton->num_levels());
+		for (int level = _job.level_begin; level < level_end; ++level)
+		{
+			const Skeleton::JointRange range = PartitionRange(_job, level);
+			for (int i = range.begin; i < range.end; i += 4)
+			{
+				// Lanes beyond the range duplicate its last joint, they are computed
+				// but never stored.
+				const int count = Math::Min(range.end - i, 4);
+				const Math::Transform* transforms[4];
+				const Matrix* parent_matrices[4];
+				Matrix* model_matrices[4];
+				for (int j = 0; j < 4; ++j)
+				{
+					const int joint = joints[i + Math::Min(j, count - 1)];
+					const int parent = parents[joint];
+					transforms[j] = &_job.input[joint];
+					parent_matrices[j] = parent == Skeleton::kNoParent ? &root_matrix : &_output[parent];
+					model_matrices[j] = &_output[joint];
+				}
+
+				SimdFloat4 local_soa[12];
+				BuildSoaAffine(transforms, local_soa);
+				SimdFloat4 parent_soa[12];
+				_Traits::LoadSoa(parent_matrices, parent_soa);
+				SimdFloat4 model_soa[12];
+				MultiplySoaAffine(local_soa, parent_soa, model_soa);
+				_Traits::StoreSoa(model_soa, model_matrices, count);
+			}
+		}
+	}
+#else  // MATH_SIMD_SSE2
+	template <typename _Traits>
+	void LocalToModelLevels(const LocalToModelLevelJob& _job, span<typename _Traits::Matrix> _output)
+	{
+		typedef typename _Traits::Matrix Matrix;
+
+		const std::vector<int16_t>& parents = _job.skeleton->joint_parents();
+		const std::vector<int16_t>& joints = _job.skeleton->level_joints();
+
+		const Matrix root_matrix(_job.root == nullptr ? Math::Mat4::IDENTITY : *_job.root);
+
+		const int level_end = Math::Min(_job.level_end, _job.skeleton->num_levels());
+		for (int level = _job.level_begin; level < level_end; ++level)
+		{
+			const Skeleton::JointRange range = PartitionRange(_job, level);
+			for (int i = range.begin; i < range.end; ++i)
+			{
+				const int joint = joints[i];
+				const Math::Transform& transform = _job.input[joint];
+				const Math::Mat4 local_aos_matrices = Math::MathUtil::Transformation(
+					transform.m_scale, transform.m_rotation, transform.m_translation);
+
+				const int parent = parents[joint];
+				const Matrix& parent_matrix =
+					parent == Skeleton::kNoParent ? root_matrix : _output[parent];
+				_Traits::Store(local_aos_matrices * _Traits::Load(parent_matrix), &_output[joint]);
+			}
+		}
+	}
+#endif  // MATH_SIMD_SSE2
+}  // namespace
+
+bool LocalToModelLevelJob::Run() const
+{
+	if (!Validate()) {
+		return false;
+	}
+
+#if MATH_SIMD_SSE2
+	if (!affine_output.empty())
+	{
+		LocalToModelLevels<SoaMat3x4Traits>(*this, affine_output);
+	}
+	else
+	{
+		LocalToModelLevels<SoaMat4Traits>(*this, output);
+	}
+#else  // MATH_SIMD_SSE2
+	if (!affine_output.empty())
+	{
+		LocalToModelLevels<Mat3x4Traits>(*this, affine_output);
+	}
+	else
+	{
+		LocalToModelLevels<Mat4Traits>(*this, output);
+	}
+#endif  // MATH_SIMD_SSE2
+
+	return true;
+}
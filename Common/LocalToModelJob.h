@@ -7,6 +7,7 @@ namespace Math
 {
 	class Transform;
 	class Mat4;
+	class Mat3x4;
 }
 
 // Forward declares the Skeleton object used to describe joint hierarchy.
@@ -21,6 +22,8 @@ class Skeleton;
 // ordered like skeleton's joints. Output are matrices, because the combination
 // of affine transformations can contain shearing or complex transformation
 // that cannot be represented as Transform object.
+// Model-space matrices can alternatively be output in the compact Mat3x4
+// format, which drops the constant last column of affine matrices.
 struct LocalToModelJob
 {
 	// Default constructor, initializes default values.
@@ -30,8 +33,8 @@ struct LocalToModelJob
 	// -if any input pointer, including ranges, is nullptr.
 	// -if the size of the input is smaller than the skeleton's number of joints.
 	// Note that this input has a SoA format.
-	// -if the size of of the output is smaller than the skeleton's number of
-	// joints.
+	// -if the size of of the output (or affine_output when it is used) is smaller
+	// than the skeleton's number of joints.
 	bool Validate() const;
 
 	// Runs job's local-to-model task.
@@ -48,7 +51,8 @@ struct LocalToModelJob
 
 	// The root matrix will multiply to every model space matrices, default nullptr
 	// means an identity matrix. This can be used to directly compute world-space
-	// transforms for example.
+	// transforms for example. When affine_output is used, root is expected to be
+	// affine, as its last column is ignored.
 	const Math::Mat4* root;
 
 	// Defines "from" which joint the local-to-model conversion should start.
@@ -81,4 +85,120 @@ struct LocalToModelJob
 
 	// The output range to be filled with model-space matrices.
 	span<Math::Mat4> output;
+
+	// Optional compact output range, to be filled with model-space matrices in
+	// Mat3x4 format instead of output. If not empty, it is used and output is
+	// left untouched.
+	span<Math::Mat3x4> affine_output;
+};
+
+// Computes model-space joint matrices for many instances of the same skeleton
+// at once, typically a crowd.
+// Instances are processed in lock-step, 4 at a time: for every joint, the
+// instances are stored in the 4 lanes of SIMD registers. Parent lookups and
+// hierarchy branches are thus shared by the whole batch, and memory accesses
+// follow the same predictable pattern for every instance.
+// Unlike LocalToModelJob, the whole hierarchy is always updated, and root
+// matrices are expected to be affine.
+struct LocalToModelBatchJob
+{
+	// Default constructor, initializes default values.
+	LocalToModelBatchJob();
+
+	// Validates job parameters. Returns true for a valid job, or false otherwise:
+	// -if skeleton is nullptr.
+	// -if the number of outputs (or affine_outputs when they are used) doesn't
+	// match the number of inputs.
+	// -if roots isn't empty and is smaller than the number of inputs.
+	// -if any input or output range is smaller than the skeleton's number of
+	// joints.
+	bool Validate() const;
+
+	// Runs job's local-to-model task for all instances.
+	// The job is validated before any operation is performed, see Validate() for
+	// more details.
+	// Returns false if job is not valid. See Validate() function.
+	bool Run() const;
+
+	// Job input.
+
+	// The Skeleton object shared by all instances.
+	const Skeleton* skeleton;
+
+	// Optional root matrix of each instance, typically its world transform.
+	// Default empty range means identity matrices.
+	span<const Math::Mat4> roots;
+
+	// The local transforms of each instance, one range per instance.
+	span<const span<const Math::Transform>> inputs;
+
+	// Job output.
+
+	// The model-space matrices of each instance, one range per instance.
+	span<const span<Math::Mat4>> outputs;
+
+	// Optional compact output ranges, used instead of outputs if not empty. See
+	// LocalToModelJob::affine_output.
+	span<const span<Math::Mat3x4>> affine_outputs;
+};
+
+// Computes model-space joint matrices level by level, using the skeleton depth
+// levels (see Skeleton::level_joints()).
+// All the joints of a level only depend on the previous levels, so they are
+// converted together, 4 per SIMD iteration whatever their parents are. This
+// also allows to split a level across threads for very large rigs: every
+// thread runs a job for its own partition of the level, and all of them must
+// complete before the next level is processed.
+// Root matrix is expected to be affine.
+struct LocalToModelLevelJob
+{
+	// Default constructor, initializes default values.
+	LocalToModelLevelJob();
+
+	// Validates job parameters. Returns true for a valid job, or false otherwise:
+	// -if any input pointer, including ranges, is nullptr.
+	// -if the size of the input, or the output (or affine_output when it is
+	// used), is smaller than the skeleton's number of joints.
+	// -if the partition isn't in range [0,num_partitions[.
+	// -if the job is partitioned but doesn't process a single level.
+	bool Validate() const;
+
+	// Runs job's local-to-model task.
+	// The job is validated before any operation is performed, see Validate() for
+	// more details.
+	// Returns false if job is not valid. See Validate() function.
+	bool Run() const;
+
+	// Job input.
+
+	// The Skeleton object describing the joint hierarchy and its levels.
+	const Skeleton* skeleton;
+
+	// The root matrix will multiply to every model space matrices, default nullptr
+	// means an identity matrix.
+	const Math::Mat4* root;
+
+	// Range of levels [level_begin,level_end[ to process. Levels before
+	// level_begin must already be up to date in the output. Default values
+	// process the whole hierarchy.
+	int level_begin;
+	int level_end;
+
+	// Allows to split each level in num_partitions contiguous parts, of which
+	// only partition is processed by this job. As levels depend on each other,
+	// a partitioned job must process a single level.
+	// Default is a single partition.
+	int partition;
+	int num_partitions;
+
+	// The input range that store local transforms.
+	span<const Math::Transform> input;
+
+	// Job output.
+
+	// The output range to be filled with model-space matrices.
+	span<Math::Mat4> output;
+
+	// Optional compact output range, used instead of output if not empty.
+	span<Math::Mat3x4> affine_output;
 };
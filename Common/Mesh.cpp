@@ -1,2 +1,94 @@
 #include "Mesh.h"
 
+#include <cmath>
+
+namespace
+{
+	// Encodes a unit vector to 2 octahedral coordinates in [-1,1], stored as
+	// signed normalized 16 bits integers.
+	void EncodeOctahedral(const float* _v, int16_t* _out)
+	{
+		const float l1 = std::fabs(_v[0]) + std::fabs(_v[1]) + std::fabs(_v[2]);
+		float x = l1 > 0.f ? _v[0] / l1 : 0.f;
+		float y = l1 > 0.f ? _v[1] / l1 : 0.f;
+		if (_v[2] < 0.f)
+		{
+			// Folds the lower hemisphere over the diagonals.
+			const float fx = (1.f - std::fabs(y)) * (x >= 0.f ? 1.f : -1.f);
+			const float fy = (1.f - std::fabs(x)) * (y >= 0.f ? 1.f : -1.f);
+			x = fx;
+			y = fy;
+		}
+		_out[0] = static_cast<int16_t>(std::round(Math::Clamp(x, -1.f, 1.f) * 32767.f));
+		_out[1] = static_cast<int16_t>(std::round(Math::Clamp(y, -1.f, 1.f) * 32767.f));
+	}
+
+	void QuantizeVectors(const std::vector<float>& _vectors, int _stride, std::vector<int16_t>* _out)
+	{
+		const size_t count = _vectors.size() / _stride;
+		_out->resize(count * 2);
+		for (size_t i = 0; i < count; ++i)
+		{
+			EncodeOctahedral(&_vectors[i * _stride], &(*_out)[i * 2]);
+		}
+	}
+}  // namespace
+
+void Mesh::Quantize()
+{
+	quantized_parts.resize(parts.size());
+	for (size_t p = 0; p < parts.size(); ++p)
+	{
+		const Part& part = parts[p];
+		QuantizedPart& quantized = quantized_parts[p];
+		const int vertex_count = part.vertex_count();
+
+		// Positions are normalized in the part bounds.
+		Math::Vec3 min(0.f), max(0.f);
+		for (int i = 0; i < vertex_count; ++i)
+		{
+			const Math::Vec3 position(part.positions[i * 3], part.positions[i * 3 + 1], part.positions[i * 3 + 2]);
+			min = i == 0 ? position : Math::Vec3(Math::Min(min.x, position.x), Math::Min(min.y, position.y), Math::Min(min.z, position.z));
+			max = i == 0 ? position : Math::Vec3(Math::Max(max.x, position.x), Math::Max(max.y, position.y), Math::Max(max.z, position.z));
+		}
+		const Math::Vec3 extent = max - min;
+		quantized.positions_offset = min;
+		quantized.positions_scale = extent / 65535.f;
+		quantized.positions.resize(vertex_count * 3);
+		for (int i = 0; i < vertex_count * 3; ++i)
+		{
+			const float range = extent[i % 3];
+			const float normalized = range > 0.f ? (part.positions[i] - min[i % 3]) / range : 0.f;
+			quantized.positions[i] = static_cast<uint16_t>(std::round(Math::Clamp(normalized, 0.f, 1.f) * 65535.f));
+		}
+
+		// Normals and tangents are only quantized if all vertices have them.
+		quantized.normals.clear();
+		if (part.normals.size() == static_cast<size_t>(vertex_count) * Part::kNormalsCpnts)
+		{
+			QuantizeVectors(part.normals, Part::kNormalsCpnts, &quantized.normals);
+		}
+		quantized.tangents.clear();
+		if (part.tangents.size() == static_cast<size_t>(vertex_count) * Part::kTangentsCpnts)
+		{
+			QuantizeVectors(part.tangents, Part::kTangentsCpnts, &quantized.tangents);
+		}
+
+		// Weights are quantized cumulatively, so that rounding errors don't add
+		// up and the restored last weight never becomes negative.
+		const int weights_count = part.influences_count() - 1;
+		quantized.joint_weights.resize(part.joint_weights.size());
+		for (int i = 0; weights_count > 0 && i < vertex_count; ++i)
+		{
+			float cumulated = 0.f;
+			int previous = 0;
+			for (int j = 0; j < weights_count; ++j)
+			{
+				cumulated += part.joint_weights[i * weights_count + j];
+				const int current = static_cast<int>(std::round(Math::Clamp(cumulated, 0.f, 1.f) * 255.f));
+				quantized.joint_weights[i * weights_count + j] = static_cast<uint8_t>(Math::Max(current - previous, 0));
+				previous = Math::Max(current, previous);
+			}
+		}
+	}
+}
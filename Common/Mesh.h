@@ -2,6 +2,8 @@
 
 #include "../Math/3DMath.h"
 
+#include <string>
+
 // Defines a mesh with skinning information (joint indices and weights).
 // The mesh is subdivided into parts that group vertices according to their
 // number of influencing joints. Triangle indices are shared across mesh parts.
@@ -99,6 +101,39 @@ struct Mesh
 	typedef std::vector<Part> Parts;
 	Parts parts;
 
+	// Compact copy of a part vertex attributes, used as skinning input to reduce
+	// memory bandwidth. See Quantize() and SkinningJob quantized inputs.
+	// Attributes that aren't skinned (uvs, colors, tangents handedness) are
+	// still read from the Part.
+	struct QuantizedPart
+	{
+		int vertex_count() const { return static_cast<int>(positions.size()) / 3; }
+
+		// Positions, normalized to 16 bits unsigned integers in the part bounds:
+		// position = positions_offset + quantized * positions_scale.
+		std::vector<uint16_t> positions;
+		Math::Vec3 positions_offset;
+		Math::Vec3 positions_scale;
+
+		// Unit vectors, octahedral encoded as 2 signed normalized 16 bits
+		// integers. Empty if the part has no normals (or tangents).
+		std::vector<int16_t> normals;
+		std::vector<int16_t> tangents;
+
+		// Weights normalized to 8 bits unsigned integers. Stride equals
+		// influences_count - 1, the weight of the last joint is restored.
+		std::vector<uint8_t> joint_weights;
+	};
+	typedef std::vector<QuantizedPart> QuantizedParts;
+
+	// Optional quantized parts, matching parts one by one once Quantize() has
+	// been called, empty otherwise.
+	QuantizedParts quantized_parts;
+
+	// Builds quantized_parts from parts. Joint indices aren't duplicated, they
+	// are still read from parts.
+	void Quantize();
+
 	// Triangles indices. Indices are shared across all parts.
 	typedef std::vector<uint16_t> TriangleIndices;
 	TriangleIndices triangle_indices;
@@ -112,4 +147,25 @@ struct Mesh
 	// Inverse bind-pose matrices. These are only available for skinned meshes.
 	typedef std::vector<Math::Mat4> InversBindPoses;
 	InversBindPoses inverse_bind_poses;
+
+	// Defines a blend shape (aka morph target) as sparse deltas from the base
+	// mesh, only the vertices that the target moves are stored. See MorphJob.
+	struct MorphTarget
+	{
+		std::string name;
+
+		// Indices of the moved vertices, sorted in increasing order. Like
+		// triangle_indices, they are shared across all parts.
+		typedef std::vector<uint16_t> Indices;
+		Indices indices;
+
+		// Position deltas, 3 components per index.
+		typedef std::vector<float> Deltas;
+		Deltas position_deltas;
+
+		// Optional normal deltas, 3 components per index.
+		Deltas normal_deltas;
+	};
+	typedef std::vector<MorphTarget> MorphTargets;
+	MorphTargets morph_targets;
 };
\ No newline at end of file
@@ -0,0 +1,329 @@
+#include "MeshOptimizeJob.h"
+#include "Mesh.h"
+
+#include <algorithm>
+
+const float MeshOptimizeJob::kDefaultWeightThreshold = 1.f / 255.f;
+
+MeshOptimizeJob::MeshOptimizeJob()
+	: input(nullptr),
+	weight_threshold(kDefaultWeightThreshold),
+	output(nullptr) {}
+
+namespace
+{
+	// Tests that an optional attribute is either empty or complete.
+	template <typename _Attribute>
+	bool ValidAttribute(const _Attribute& _attribute, int _vertex_count, int _components)
+	{
+		return _attribute.empty() || _attribute.size() == static_cast<size_t>(_vertex_count) * _components;
+	}
+}  // namespace
+
+bool MeshOptimizeJob::Validate() const
+{
+	bool valid = true;
+
+	if (!input || !output)
+	{
+		return false;
+	}
+
+	valid &= weight_threshold >= 0.f && weight_threshold < 1.f;
+
+	int vertex_count = 0;
+	for (const Mesh::Part& part : input->parts)
+	{
+		const int part_vertex_count = part.vertex_count();
+		valid &= part.positions.size() == static_cast<size_t>(part_vertex_count) * Mesh::Part::kPositionsCpnts;
+		if (part_vertex_count == 0)
+		{
+			continue;
+		}
+		const int influences_count = part.influences_count();
+		valid &= influences_count > 0;
+		valid &= part.joint_indices.size() == static_cast<size_t>(part_vertex_count) * influences_count;
+		valid &= part.joint_weights.size() == static_cast<size_t>(part_vertex_count) * (influences_count - 1);
+		valid &= ValidAttribute(part.normals, part_vertex_count, Mesh::Part::kNormalsCpnts);
+		valid &= ValidAttribute(part.tangents, part_vertex_count, Mesh::Part::kTangentsCpnts);
+		valid &= ValidAttribute(part.uvs, part_vertex_count, Mesh::Part::kUVsCpnts);
+		valid &= ValidAttribute(part.colors, part_vertex_count, Mesh::Part::kColorsCpnts);
+		vertex_count += part_vertex_count;
+	}
+
+	for (uint16_t index : input->triangle_indices)
+	{
+		valid &= index < vertex_count;
+	}
+
+	for (const Mesh::MorphTarget& target : input->morph_targets)
+	{
+		for (uint16_t index : target.indices)
+		{
+			valid &= index < vertex_count;
+		}
+		valid &= target.position_deltas.size() == target.indices.size() * 3;
+		valid &= target.normal_deltas.empty() || target.normal_deltas.size() == target.indices.size() * 3;
+	}
+
+	return valid;
+}
+
+namespace
+{
+	struct Influence
+	{
+		uint16_t joint;
+		float weight;
+	};
+
+	// A vertex of the input mesh, with its pruned influences.
+	struct Vertex
+	{
+		int part;  // Input part.
+		int index;  // Index in the input part.
+		int global;  // Index in the input mesh, as used by triangle indices.
+		int first;  // First influence, in the influences buffer.
+		int count;  // Number of influences.
+	};
+
+	// Gathers, merges, sorts and prunes the influences of a vertex.
+	int PruneInfluences(const Mesh::Part& _part, int _index, float _threshold, Influence* _influences)
+	{
+		const int influences_count = _part.influences_count();
+		int count = 0;
+		float remaining = 1.f;
+		for (int j = 0; j < influences_count; ++j)
+		{
+			const uint16_t joint = _part.joint_indices[_index * influences_count + j];
+			const float weight = j < influences_count - 1
+				? _part.joint_weights[_index * (influences_count - 1) + j]
+				: remaining;
+			remaining -= weight;
+
+			int k = 0;
+			while (k < count && _influences[k].joint != joint)
+			{
+				++k;
+			}
+			if (k == count)
+			{
+				_influences[count++] = { joint, 0.f };
+			}
+			_influences[k].weight += weight;
+		}
+
+		// Sorts by decreasing weight, joint index breaking ties to remain stable.
+		std::sort(_influences, _influences + count, [](const Influence& _a, const Influence& _b)
+			{
+				return _a.weight > _b.weight || (_a.weight == _b.weight && _a.joint < _b.joint);
+			});
+
+		// Prunes, but always keeps the most weighted influence.
+		int kept = 1;
+		float sum = Math::Max(_influences[0].weight, 0.f);
+		while (kept < count && _influences[kept].weight >= _threshold)
+		{
+			sum += _influences[kept++].weight;
+		}
+		for (int k = 0; k < kept; ++k)
+		{
+			_influences[k].weight = sum > 0.f ? _influences[k].weight / sum : 1.f / kept;
+		}
+		return kept;
+	}
+
+	// Appends the _components values of vertex _index, or defaults if the
+	// attribute is missing from the input part.
+	template <typename _Ty, size_t _Components>
+	void CopyAttribute(const std::vector<_Ty>& _input, int _index, const _Ty (&_default)[_Components], std::vector<_Ty>* _output)
+	{
+		if (_input.empty())
+		{
+			_output->insert(_output->end(), _default, _default + _Components);
+		}
+		else
+		{
+			const _Ty* begin = &_input[_index * _Components];
+			_output->insert(_output->end(), begin, begin + _Components);
+		}
+	}
+
+	// Remaps the indices of a morph target, and sorts them back along with
+	// their deltas.
+	void RemapMorphTarget(const std::vector<uint16_t>& _remap, Mesh::MorphTarget* _target)
+	{
+		const size_t count = _target->indices.size();
+		std::vector<size_t> order(count);
+		for (size_t k = 0; k < count; ++k)
+		{
+			order[k] = k;
+		}
+		std::sort(order.begin(), order.end(), [&](size_t _a, size_t _b)
+			{
+				return _remap[_target->indices[_a]] < _remap[_target->indices[_b]];
+			});
+
+		const Mesh::MorphTarget source = *_target;
+		const bool normals = !source.normal_deltas.empty();
+		for (size_t k = 0; k < count; ++k)
+		{
+			const size_t from = order[k];
+			_target->indices[k] = _remap[source.indices[from]];
+			for (int c = 0; c < 3; ++c)
+			{
+				_target->position_deltas[k * 3 + c] = source.position_deltas[from * 3 + c];
+				if (normals)
+				{
+					_target->normal_deltas[k * 3 + c] = source.normal_deltas[from * 3 + c];
+				}
+			}
+		}
+	}
+}  // namespace
+
+bool MeshOptimizeJob::Run() const
+{
+	if (!Validate())
+	{
+		return false;
+	}
+
+	const Mesh& mesh = *input;
+
+	// Collects all vertices and their pruned influences.
+	std::vector<Vertex> vertices;
+	std::vector<Influence> influences;
+	vertices.reserve(mesh.vertex_count());
+	int max_influences = 0;
+	int global = 0;
+	for (int p = 0; p < static_cast<int>(mesh.parts.size()); ++p)
+	{
+		const Mesh::Part& part = mesh.parts[p];
+		const int part_vertex_count = part.vertex_count();
+		const int influences_count = part.influences_count();
+		for (int i = 0; i < part_vertex_count; ++i, ++global)
+		{
+			const int first = static_cast<int>(influences.size());
+			influences.resize(first + influences_count);
+			const int count = PruneInfluences(part, i, weight_threshold, &influences[first]);
+			influences.resize(first + count);
+			vertices.push_back({ p, i, global, first, count });
+			max_influences = Math::Max(max_influences, count);
+		}
+	}
+
+	// Buckets by influences count, then sorts by dominant joint. Joint indices
+	// of the following influences, then the original order, break ties so that
+	// the result is deterministic.
+	std::sort(vertices.begin(), vertices.end(), [&influences](const Vertex& _a, const Vertex& _b)
+		{
+			if (_a.count != _b.count)
+			{
+				return _a.count < _b.count;
+			}
+			for (int j = 0; j < _a.count; ++j)
+			{
+				const uint16_t a = influences[_a.first + j].joint;
+				const uint16_t b = influences[_b.first + j].joint;
+				if (a != b)
+				{
+					return a < b;
+				}
+			}
+			return _a.global < _b.global;
+		});
+
+	// Tests which attributes exist in the input parts merged to each output
+	// part.
+	struct Attributes
+	{
+		bool normals, tangents, uvs, colors;
+	};
+	std::vector<Attributes> attributes(max_influences + 1, Attributes{ false, false, false, false });
+	for (const Vertex& vertex : vertices)
+	{
+		const Mesh::Part& part = mesh.parts[vertex.part];
+		Attributes& attribute = attributes[vertex.count];
+		attribute.normals |= !part.normals.empty();
+		attribute.tangents |= !part.tangents.empty();
+		attribute.uvs |= !part.uvs.empty();
+		attribute.colors |= !part.colors.empty();
+	}
+
+	static const float kDefaultNormal[Mesh::Part::kNormalsCpnts] = { 0.f, 1.f, 0.f };
+	static const float kDefaultTangent[Mesh::Part::kTangentsCpnts] = { 1.f, 0.f, 0.f, 1.f };
+	static const float kDefaultUV[Mesh::Part::kUVsCpnts] = { 0.f, 0.f };
+	static const uint8_t kDefaultColor[Mesh::Part::kColorsCpnts] = { 255, 255, 255, 255 };
+
+	// Builds output parts, and the vertex remapping table.
+	Mesh::Parts parts;
+	std::vector<uint16_t> remap(vertices.size());
+	for (size_t v = 0; v < vertices.size(); ++v)
+	{
+		const Vertex& vertex = vertices[v];
+		const Mesh::Part& in = mesh.parts[vertex.part];
+		if (v == 0 || vertices[v - 1].count != vertex.count)
+		{
+			parts.resize(parts.size() + 1);
+		}
+		Mesh::Part& out = parts.back();
+		remap[vertex.global] = static_cast<uint16_t>(v);
+
+		const float* position = &in.positions[vertex.index * Mesh::Part::kPositionsCpnts];
+		out.positions.insert(out.positions.end(), position, position + Mesh::Part::kPositionsCpnts);
+
+		const Attributes& attribute = attributes[vertex.count];
+		if (attribute.normals)
+		{
+			CopyAttribute(in.normals, vertex.index, kDefaultNormal, &out.normals);
+		}
+		if (attribute.tangents)
+		{
+			CopyAttribute(in.tangents, vertex.index, kDefaultTangent, &out.tangents);
+		}
+		if (attribute.uvs)
+		{
+			CopyAttribute(in.uvs, vertex.index, kDefaultUV, &out.uvs);
+		}
+		if (attribute.colors)
+		{
+			CopyAttribute(in.colors, vertex.index, kDefaultColor, &out.colors);
+		}
+
+		for (int j = 0; j < vertex.count; ++j)
+		{
+			const Influence& influence = influences[vertex.first + j];
+			out.joint_indices.push_back(influence.joint);
+			if (j < vertex.count - 1)
+			{
+				out.joint_weights.push_back(influence.weight);
+			}
+		}
+	}
+
+	Mesh::TriangleIndices triangle_indices(mesh.triangle_indices.size());
+	for (size_t i = 0; i < triangle_indices.size(); ++i)
+	{
+		triangle_indices[i] = remap[mesh.triangle_indices[i]];
+	}
+
+	Mesh::MorphTargets morph_targets = mesh.morph_targets;
+	for (Mesh::MorphTarget& target : morph_targets)
+	{
+		RemapMorphTarget(remap, &target);
+	}
+
+	// Input is fully read, output can now be written even if it's the same mesh.
+	if (output != input)
+	{
+		output->joint_remaps = mesh.joint_remaps;
+		output->inverse_bind_poses = mesh.inverse_bind_poses;
+	}
+	output->parts.swap(parts);
+	output->triangle_indices.swap(triangle_indices);
+	output->morph_targets.swap(morph_targets);
+	output->quantized_parts.clear();
+
+	return true;
+}
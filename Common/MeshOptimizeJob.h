@@ -0,0 +1,59 @@
+#pragma once
+
+// Forward declares the Mesh object.
+struct Mesh;
+
+// Rebuilds a mesh so that skinning reads joint palettes as linearly as
+// possible. Meant to be run once, at load time or offline:
+// - influences whose weight is below weight_threshold are pruned, and
+// remaining weights renormalized. Duplicated joint indices are merged.
+// - vertices are re-bucketed in parts according to their actual number of
+// influences, parts being sorted by increasing influences count.
+// - vertices of a part are sorted by dominant (most weighted) joint, so that
+// consecutive vertices mostly read the same palette matrices.
+// - triangle_indices and morph targets indices are remapped to the new vertex
+// order.
+// Influences of a vertex are stored by decreasing weight, so the restored last
+// weight is the smallest one. Vertex attributes that are missing from some of
+// the input parts merged to an output part are filled with default values
+// (the ones the renderer uses). Quantized parts aren't kept, Mesh::Quantize()
+// should be called on the output if needed.
+struct MeshOptimizeJob
+{
+	// Default weight threshold, below which an influence is considered
+	// negligible.
+	static const float kDefaultWeightThreshold;
+
+	// Default constructor, initializes default values.
+	MeshOptimizeJob();
+
+	// Validates job parameters. Returns true for a valid job, or false otherwise:
+	// -if input or output is nullptr.
+	// -if weight_threshold isn't in range [0,1[.
+	// -if any input part has no joint influence, or inconsistent joint indices,
+	// weights, or vertex attributes sizes.
+	// -if any triangle or morph target index is out of the input vertices range,
+	// or any morph target deltas size doesn't match its indices.
+	bool Validate() const;
+
+	// Runs job's optimization task.
+	// The job is validated before any operation is performed, see Validate() for
+	// more details.
+	// Returns false if job is not valid. See Validate() function.
+	bool Run() const;
+
+	// Job input.
+
+	// The mesh to optimize. It can be the same as output.
+	const Mesh* input;
+
+	// Influences with a weight below this threshold are pruned. A vertex always
+	// keeps its most weighted influence.
+	float weight_threshold;
+
+	// Job output.
+
+	// The optimized mesh. Skinning data (joint_remaps, inverse_bind_poses) are
+	// copied from input.
+	Mesh* output;
+};
@@ -0,0 +1,145 @@
+#include "MorphJob.h"
+#include "../Math/SimdMath.h"
+
+#include <algorithm>
+
+MorphJob::MorphJob()
+	: vertex_count(0),
+	vertex_offset(0),
+	in_positions_stride(0),
+	in_normals_stride(0),
+	out_positions_stride(0),
+	out_normals_stride(0) {}
+
+bool MorphJob::Validate() const
+{
+	bool valid = true;
+
+	valid &= vertex_count >= 0;
+	valid &= vertex_offset >= 0;
+	valid &= weights.size() >= targets.size();
+
+	for (const Mesh::MorphTarget& target : targets)
+	{
+		valid &= target.position_deltas.size() == target.indices.size() * 3;
+		valid &= target.normal_deltas.empty() || target.normal_deltas.size() == target.indices.size() * 3;
+	}
+
+	// Ranges must be big enough to store all vertices.
+	const size_t vertex_count_minus_1 = vertex_count > 0 ? vertex_count - 1 : 0;
+	const size_t vertex_count_at_least_1 = vertex_count > 0;
+
+	valid &= in_positions.size_bytes() >=
+		in_positions_stride * vertex_count_minus_1 +
+		sizeof(float) * 3 * vertex_count_at_least_1;
+	valid &= out_positions.size_bytes() >=
+		out_positions_stride * vertex_count_minus_1 +
+		sizeof(float) * 3 * vertex_count_at_least_1;
+
+	if (!in_normals.empty())
+	{
+		valid &= in_normals.size_bytes() >=
+			in_normals_stride * vertex_count_minus_1 +
+			sizeof(float) * 3 * vertex_count_at_least_1;
+		valid &= out_normals.size_bytes() >=
+			out_normals_stride * vertex_count_minus_1 +
+			sizeof(float) * 3 * vertex_count_at_least_1;
+	}
+
+	return valid;
+}
+
+namespace
+{
+	// Copies base attributes to the output, unless they are already there.
+	void CopyBase(const float* _in, size_t _in_stride, float* _out, size_t _out_stride, int _count)
+	{
+		if (_in == _out && _in_stride == _out_stride)
+		{
+			return;
+		}
+		for (int i = 0; i < _count; ++i)
+		{
+			const float* in = PointerStride(_in, _in_stride * i);
+			float* out = PointerStride(_out, _out_stride * i);
+			out[0] = in[0];
+			out[1] = in[1];
+			out[2] = in[2];
+		}
+	}
+
+	// Adds _weight * _deltas[k] to the vertices _indices[k] - _offset, for k in
+	// [_begin,_end[.
+	void Accumulate(const uint16_t* _indices, const float* _deltas, int _begin, int _end,
+		float _weight, int _offset, float* _out, size_t _out_stride)
+	{
+#if MATH_SIMD_SSE2
+		const Math::SimdFloat4 weight = Math::simd::Load1(_weight);
+		for (int k = _begin; k < _end; ++k)
+		{
+			float* out = PointerStride(_out, _out_stride * (_indices[k] - _offset));
+			const Math::SimdFloat4 delta = Math::simd::Load3PtrU(_deltas + k * 3);
+			Math::simd::Store3PtrU(Math::simd::MAdd(delta, weight, Math::simd::Load3PtrU(out)), out);
+		}
+#else  // MATH_SIMD_SSE2
+		for (int k = _begin; k < _end; ++k)
+		{
+			float* out = PointerStride(_out, _out_stride * (_indices[k] - _offset));
+			const float* delta = _deltas + k * 3;
+			out[0] += delta[0] * _weight;
+			out[1] += delta[1] * _weight;
+			out[2] += delta[2] * _weight;
+		}
+#endif  // MATH_SIMD_SSE2
+	}
+}  // namespace
+
+bool MorphJob::Run() const
+{
+	if (!Validate())
+	{
+		return false;
+	}
+
+	if (vertex_count == 0)
+	{
+		return true;
+	}
+
+	const bool normals = !in_normals.empty();
+	CopyBase(in_positions.begin(), in_positions_stride, out_positions.begin(), out_positions_stride, vertex_count);
+	if (normals)
+	{
+		CopyBase(in_normals.begin(), in_normals_stride, out_normals.begin(), out_normals_stride, vertex_count);
+	}
+
+	for (size_t t = 0; t < targets.size(); ++t)
+	{
+		const float weight = weights[t];
+		if (weight == 0.f)
+		{
+			continue;
+		}
+
+		// Indices are sorted, so the ones of the processed vertices are found by
+		// binary search.
+		const Mesh::MorphTarget& target = targets[t];
+		const Mesh::MorphTarget::Indices& indices = target.indices;
+		const int begin = static_cast<int>(std::lower_bound(indices.begin(), indices.end(), vertex_offset) - indices.begin());
+		const int end = static_cast<int>(std::lower_bound(indices.begin() + begin, indices.end(), vertex_offset + vertex_count) - indices.begin());
+		if (begin == end)
+		{
+			continue;
+		}
+
+		Accumulate(indices.data(), target.position_deltas.data(), begin, end,
+			weight, vertex_offset, out_positions.begin(), out_positions_stride);
+		if (normals && !target.normal_deltas.empty())
+		{
+			Accumulate(indices.data(), target.normal_deltas.data(), begin, end,
+				weight, vertex_offset, out_normals.begin(), out_normals_stride);
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Mesh.h"
+#include "span.h"
+
+// Applies weighted blend shapes (see Mesh::MorphTarget) to the vertices of a
+// mesh part, before it's skinned. Output is the base position (and normal),
+// plus the sum of the weighted deltas of every target.
+// Targets are sparse, so the cost is proportional to the number of vertices
+// each target moves, rather than to the number of vertices of the mesh.
+// Targets with a zero weight are skipped.
+// Output normals aren't normalized, which isn't required by SkinningJob.
+struct MorphJob
+{
+	// Default constructor, initializes default values.
+	MorphJob();
+
+	// Validates job parameters. Returns true for a valid job, or false otherwise:
+	// -if vertex_offset is negative.
+	// -if there are less weights than targets.
+	// -if any target doesn't have 3 position deltas per index, or has normal
+	// deltas but not 3 per index.
+	// -if any input or output range is too small for vertex_count vertices.
+	// -if input normals are provided but output normals aren't.
+	// Targets indices must also be strictly increasing, as LoadFile ensures. This
+	// isn't checked, as it would visit every index of every target on each run.
+	bool Validate() const;
+
+	// Runs job's morphing task.
+	// The job is validated before any operation is performed, see Validate() for
+	// more details.
+	// Returns false if job is not valid. See Validate() function.
+	bool Run() const;
+
+	// Job input.
+
+	// Number of vertices to process.
+	int vertex_count;
+
+	// Index, in the whole mesh, of the first processed vertex. As targets
+	// indices are shared across parts, this is the number of vertices of the
+	// parts before the processed one.
+	int vertex_offset;
+
+	// Morph targets, and their weights, one weight per target.
+	span<const Mesh::MorphTarget> targets;
+	span<const float> weights;
+
+	// Base vertex positions (3 float values per vertex) array and stride.
+	span<const float> in_positions;
+	size_t in_positions_stride;
+
+	// Optional base vertex normals (3 float values per vertex) array and stride.
+	span<const float> in_normals;
+	size_t in_normals_stride;
+
+	// Job output.
+
+	// Output vertex positions (3 float values per vertex) array and stride. It
+	// can then be used as SkinningJob::in_positions.
+	span<float> out_positions;
+	size_t out_positions_stride;
+
+	// Output vertex normals (3 float values per vertex) array and stride.
+	// Required if input normals are provided.
+	span<float> out_normals;
+	size_t out_normals_stride;
+};
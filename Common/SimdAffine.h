@@ -0,0 +1,145 @@
+#pragma once
+
+#include "../Math/3DMath.h"
+#include "../Math/SimdMath.h"
+
+// SIMD helpers shared by the jobs that build affine joint matrices from local
+// transforms. This is an implementation header, not part of the public API.
+
+#if MATH_SIMD_SSE2
+
+namespace internal
+{
+	using Math::SimdFloat4;
+
+	// Builds the 12 meaningful components of the affine matrices of 4 joints at
+	// once, following MathUtil::Transformation. Transforms are transposed to SoA
+	// on the fly, so each output register holds the same component for the 4
+	// joints, in that order: a11 a12 a13 a21 a22 a23 a31 a32 a33 a41 a42 a43.
+	inline void BuildSoaAffine(const Math::Transform* const _transforms[4], SimdFloat4 _m[12])
+	{
+		// Math::Transform is 10 contiguous floats: translation xyz, rotation xyzw
+		// and scale xyz. Each of the 3 loads below stays within these 10 floats.
+		static_assert(sizeof(Math::Transform) == sizeof(float) * 10,
+			"Algorithm relies on Transform being 10 packed floats");
+		const float* t0 = &_transforms[0]->m_translation.x;
+		const float* t1 = &_transforms[1]->m_translation.x;
+		const float* t2 = &_transforms[2]->m_translation.x;
+		const float* t3 = &_transforms[3]->m_translation.x;
+
+		SimdFloat4 tx = Math::simd::LoadPtrU(t0);
+		SimdFloat4 ty = Math::simd::LoadPtrU(t1);
+		SimdFloat4 tz = Math::simd::LoadPtrU(t2);
+		SimdFloat4 tw = Math::simd::LoadPtrU(t3);
+		Math::simd::Transpose4x4(tx, ty, tz, tw);
+
+		SimdFloat4 qx = Math::simd::LoadPtrU(t0 + 3);
+		SimdFloat4 qy = Math::simd::LoadPtrU(t1 + 3);
+		SimdFloat4 qz = Math::simd::LoadPtrU(t2 + 3);
+		SimdFloat4 qw = Math::simd::LoadPtrU(t3 + 3);
+		Math::simd::Transpose4x4(qx, qy, qz, qw);
+
+		SimdFloat4 sw = Math::simd::LoadPtrU(t0 + 6);
+		SimdFloat4 sx = Math::simd::LoadPtrU(t1 + 6);
+		SimdFloat4 sy = Math::simd::LoadPtrU(t2 + 6);
+		SimdFloat4 sz = Math::simd::LoadPtrU(t3 + 6);
+		Math::simd::Transpose4x4(sw, sx, sy, sz);
+
+		const SimdFloat4 one = Math::simd::One();
+		const SimdFloat4 x2 = _mm_add_ps(qx, qx);
+		const SimdFloat4 y2 = _mm_add_ps(qy, qy);
+		const SimdFloat4 z2 = _mm_add_ps(qz, qz);
+		const SimdFloat4 xx2 = _mm_mul_ps(qx, x2);
+		const SimdFloat4 xy2 = _mm_mul_ps(qx, y2);
+		const SimdFloat4 xz2 = _mm_mul_ps(qx, z2);
+		const SimdFloat4 yy2 = _mm_mul_ps(qy, y2);
+		const SimdFloat4 yz2 = _mm_mul_ps(qy, z2);
+		const SimdFloat4 zz2 = _mm_mul_ps(qz, z2);
+		const SimdFloat4 wx2 = _mm_mul_ps(qw, x2);
+		const SimdFloat4 wy2 = _mm_mul_ps(qw, y2);
+		const SimdFloat4 wz2 = _mm_mul_ps(qw, z2);
+
+		_m[0] = _mm_mul_ps(sx, _mm_sub_ps(_mm_sub_ps(one, yy2), zz2));
+		_m[1] = _mm_mul_ps(sx, _mm_add_ps(xy2, wz2));
+		_m[2] = _mm_mul_ps(sx, _mm_sub_ps(xz2, wy2));
+		_m[3] = _mm_mul_ps(sy, _mm_sub_ps(xy2, wz2));
+		_m[4] = _mm_mul_ps(sy, _mm_sub_ps(_mm_sub_ps(one, xx2), zz2));
+		_m[5] = _mm_mul_ps(sy, _mm_add_ps(yz2, wx2));
+		_m[6] = _mm_mul_ps(sz, _mm_add_ps(xz2, wy2));
+		_m[7] = _mm_mul_ps(sz, _mm_sub_ps(yz2, wx2));
+		_m[8] = _mm_mul_ps(sz, _mm_sub_ps(_mm_sub_ps(one, xx2), yy2));
+		_m[9] = tx;
+		_m[10] = ty;
+		_m[11] = tz;
+	}
+
+	// Mat4 output. Matrices are processed as their 4 rows, and multiplied the
+	// row vector way: model = local * parent. As local matrices are affine, the
+	// terms of their constant last column are skipped, which is exact whatever
+	// the parent matrix is.
+	struct Mat4Traits
+	{
+		typedef Math::Mat4 Matrix;
+
+		// Transposes soa components to per-joint local matrix rows.
+		static void Locals(SimdFloat4 _m[12], SimdFloat4 _locals[4][4])
+		{
+			SimdFloat4 r0[4] = { _m[0], _m[1], _m[2], Math::simd::Zero() };
+			SimdFloat4 r1[4] = { _m[3], _m[4], _m[5], Math::simd::Zero() };
+			SimdFloat4 r2[4] = { _m[6], _m[7], _m[8], Math::simd::Zero() };
+			SimdFloat4 r3[4] = { _m[9], _m[10], _m[11], Math::simd::One() };
+			SimdFloat4* rows[4] = { r0, r1, r2, r3 };
+			for (int r = 0; r < 4; ++r)
+			{
+				Math::simd::Transpose4x4(rows[r][0], rows[r][1], rows[r][2], rows[r][3]);
+				for (int j = 0; j < 4; ++j)
+				{
+					_locals[j][r] = rows[r][j];
+				}
+			}
+		}
+
+		static void Load(const Matrix& _matrix, SimdFloat4 _rows[4])
+		{
+			_rows[0] = Math::simd::LoadPtrU(_matrix.m + 0);
+			_rows[1] = Math::simd::LoadPtrU(_matrix.m + 4);
+			_rows[2] = Math::simd::LoadPtrU(_matrix.m + 8);
+			_rows[3] = Math::simd::LoadPtrU(_matrix.m + 12);
+		}
+
+		static void Store(const SimdFloat4 _rows[4], Matrix* _output)
+		{
+			Math::simd::StorePtrU(_rows[0], _output->m + 0);
+			Math::simd::StorePtrU(_rows[1], _output->m + 4);
+			Math::simd::StorePtrU(_rows[2], _output->m + 8);
+			Math::simd::StorePtrU(_rows[3], _output->m + 12);
+		}
+
+		static void Multiply(const SimdFloat4 _local[4], const SimdFloat4 _parent[4], SimdFloat4 _output[4])
+		{
+			using Math::simd::MAdd;
+			using Math::simd::Splat;
+			for (int r = 0; r < 3; ++r)
+			{
+				_output[r] =
+					MAdd(Splat<2>(_local[r]), _parent[2],
+						MAdd(Splat<1>(_local[r]), _parent[1],
+							_mm_mul_ps(Splat<0>(_local[r]), _parent[0])));
+			}
+			_output[3] = _mm_add_ps(
+				MAdd(Splat<2>(_local[3]), _parent[2],
+					MAdd(Splat<1>(_local[3]), _parent[1],
+						_mm_mul_ps(Splat<0>(_local[3]), _parent[0]))),
+				_parent[3]);
+		}
+
+		static void MultiplyStore(const SimdFloat4 _local[4], const SimdFloat4 _parent[4], Matrix* _output)
+		{
+			SimdFloat4 rows[4];
+			Multiply(_local, _parent, rows);
+			Store(rows, _output);
+		}
+	};
+}  // namespace internal
+
+#endif  // MATH_SIMD_SSE2
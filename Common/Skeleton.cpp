@@ -1,5 +1,7 @@
 #include "Skeleton.h"
 
+#include <cstring>
+
 Skeleton::Skeleton()
 {
 
@@ -8,4 +10,110 @@ Skeleton::Skeleton()
 Skeleton::~Skeleton()
 {
     
-}
\ No newline at end of file
+}
+
+void Skeleton::BuildJointNameIndex()
+{
+	const int num_joints = static_cast<int>(joint_name_offsets_.size());
+
+	size_t num_buckets = 1;
+	while (num_buckets < static_cast<size_t>(num_joints) * 2)
+	{
+		num_buckets <<= 1;
+	}
+	const size_t mask = num_buckets - 1;
+
+	joint_name_hashes_.resize(num_joints);
+	joint_name_index_.assign(num_buckets, -1);
+	for (int i = 0; i < num_joints; ++i)
+	{
+		const uint hash = HashString(joint_name(i));
+		joint_name_hashes_[i] = hash;
+
+		// Joints are inserted in order, so the first of a same name is found
+		// first.
+		size_t bucket = hash & mask;
+		while (joint_name_index_[bucket] >= 0)
+		{
+			bucket = (bucket + 1) & mask;
+		}
+		joint_name_index_[bucket] = static_cast<int16_t>(i);
+	}
+}
+
+int Skeleton::FindJoint(const JointName& _name) const
+{
+	if (joint_name_index_.empty())
+	{
+		return -1;
+	}
+	const size_t mask = joint_name_index_.size() - 1;
+	for (size_t bucket = _name.hash() & mask;; bucket = (bucket + 1) & mask)
+	{
+		const int joint = joint_name_index_[bucket];
+		if (joint < 0)
+		{
+			return -1;
+		}
+		if (joint_name_hashes_[joint] == _name.hash() && std::strcmp(joint_name(joint), _name.name()) == 0)
+		{
+			return joint;
+		}
+	}
+}
+
+void Skeleton::BuildHierarchyLevels()
+{
+	const int num_joints = static_cast<int>(joint_parents_.size());
+
+	// Joints are stored in depth-first order, so a parent is always processed
+	// before its children.
+	int num_levels = 0;
+	joint_depths_.resize(num_joints);
+	for (int i = 0; i < num_joints; ++i)
+	{
+		const int parent = joint_parents_[i];
+		assert(parent < i && "Joints must be in depth-first order.");
+		joint_depths_[i] = parent == kNoParent ? 0 : joint_depths_[parent] + 1;
+		num_levels = Math::Max(num_levels, joint_depths_[i] + 1);
+	}
+
+	// Counting sort by depth, which is stable and thus keeps the depth-first
+	// order within each level.
+	level_offsets_.assign(num_levels + 1, 0);
+	for (int i = 0; i < num_joints; ++i)
+	{
+		++level_offsets_[joint_depths_[i] + 1];
+	}
+	for (int l = 0; l < num_levels; ++l)
+	{
+		level_offsets_[l + 1] += level_offsets_[l];
+	}
+	std::vector<int16_t> cursors(level_offsets_.begin(), level_offsets_.end() - 1);
+	level_joints_.resize(num_joints);
+	for (int i = 0; i < num_joints; ++i)
+	{
+		level_joints_[cursors[joint_depths_[i]]++] = static_cast<int16_t>(i);
+	}
+
+	// Depth-first order implies that children of a same parent are contiguous
+	// once sorted by level.
+	sibling_groups_.clear();
+	child_ranges_.assign(num_joints, JointRange{ 0, 0 });
+	for (int begin = 0; begin < num_joints;)
+	{
+		const int16_t parent = joint_parents_[level_joints_[begin]];
+		int end = begin + 1;
+		while (end < num_joints && joint_parents_[level_joints_[end]] == parent)
+		{
+			++end;
+		}
+		const SiblingGroup group = { parent, { static_cast<int16_t>(begin), static_cast<int16_t>(end) } };
+		sibling_groups_.push_back(group);
+		if (parent != kNoParent)
+		{
+			child_ranges_[parent] = group.joints;
+		}
+		begin = end;
+	}
+}
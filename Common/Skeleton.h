@@ -1,8 +1,26 @@
 #pragma once
 
 #include "../System/Macros.h"
+#include "../System/TypeHash.h"
 #include "../Math/3DMath.h"
 
+// Joint name key, whose hash is computed at compile time when the key is a
+// constexpr variable built from a string literal:
+// static constexpr JointName kHand("Bip01 L Hand");
+// The name must outlive the key.
+class JointName
+{
+public:
+	constexpr JointName(const char* _name) : name_(_name), hash_(HashString(_name)) {}
+
+	constexpr const char* name() const { return name_; }
+	constexpr uint hash() const { return hash_; }
+
+private:
+	const char* name_;
+	uint hash_;
+};
+
 class Skeleton
 {
     friend class LoadFile;
@@ -30,7 +48,22 @@ public:
 		kNoParent = -1,
 	};
 
-	int num_joints() const { return joint_names_.size(); }
+	// Defines a range [begin,end[ of joints in level order, see level_joints().
+	struct JointRange
+	{
+		int16_t begin;
+		int16_t end;
+	};
+
+	// Defines a group of joints sharing the same parent. Siblings are contiguous
+	// in level order.
+	struct SiblingGroup
+	{
+		int16_t parent;  // kNoParent for the group of roots.
+		JointRange joints;
+	};
+
+	int num_joints() const { return static_cast<int>(joint_parents_.size()); }
 
 	// Returns joint's parent indices range.
 	const std::vector<int16_t>& joint_parents() const { return joint_parents_; }
@@ -40,18 +73,78 @@ public:
 		return joint_rest_poses_;
 	}
 
-	// Returns joint's name collection.
-	const std::vector<std::string>& joint_names() const {
-		return joint_names_;
+	// Returns the null terminated name of joint _joint.
+	const char* joint_name(int _joint) const {
+		return joint_name_pool_.data() + joint_name_offsets_[_joint];
+	}
+
+	// Finds joint index by name, or returns -1 if there's no such joint. Uses a
+	// case sensitive comparison, and returns the first joint in depth-first
+	// order if several have the same name.
+	int FindJoint(const JointName& _name) const;
+
+	// Returns the depth of every joint in the hierarchy, 0 for roots.
+	const std::vector<int16_t>& joint_depths() const { return joint_depths_; }
+
+	// Returns the number of depth levels of the hierarchy.
+	int num_levels() const { return static_cast<int>(level_offsets_.size()) - 1; }
+
+	// Returns joint indices sorted by depth level. Depth-first order is kept
+	// within a level, which makes siblings contiguous. Joints of a same level
+	// don't depend on each other, so they can be processed together.
+	const std::vector<int16_t>& level_joints() const { return level_joints_; }
+
+	// Returns the range of level_joints() belonging to level _level.
+	JointRange level_range(int _level) const {
+		const JointRange range = { level_offsets_[_level], level_offsets_[_level + 1] };
+		return range;
 	}
+
+	// Returns the groups of siblings, in level order.
+	const std::vector<SiblingGroup>& sibling_groups() const { return sibling_groups_; }
+
+	// Returns the range of level_joints() that stores the direct children of
+	// every joint. The range is empty for leaves.
+	const std::vector<JointRange>& child_ranges() const { return child_ranges_; }
+
 private:
 
+	// Builds the joint names hash index from the names pool. Must be called
+	// once all names are added.
+	void BuildJointNameIndex();
+
+	// Computes depth levels, sibling groups and child ranges from joint_parents_.
+	// Must be called once joint_parents_ is set.
+	void BuildHierarchyLevels();
+
 	// Rest pose of every joint in local space.
 	std::vector<Math::Transform> joint_rest_poses_;
 
 	// Array of joint parent indexes.
 	std::vector<int16_t> joint_parents_;
 
-	// Stores the name of every joint in an array of c-strings.
-	std::vector<std::string> joint_names_;
+	// Names of all joints, null terminated and stored one after the other, and
+	// offset of every joint's name in the pool.
+	std::vector<char> joint_name_pool_;
+	std::vector<uint32_t> joint_name_offsets_;
+
+	// Hash of every joint name, and open addressing (linear probing) hash table
+	// of joint indices, -1 for empty buckets. The table size is a power of 2 at
+	// least twice the number of joints, so it always has empty buckets.
+	std::vector<uint> joint_name_hashes_;
+	std::vector<int16_t> joint_name_index_;
+
+	// Depth of every joint, 0 for roots.
+	std::vector<int16_t> joint_depths_;
+
+	// Joint indices sorted by depth level, and offset of each level in this
+	// array. There's one more offset than levels.
+	std::vector<int16_t> level_joints_;
+	std::vector<int16_t> level_offsets_;
+
+	// Groups of joints sharing the same parent, in level order.
+	std::vector<SiblingGroup> sibling_groups_;
+
+	// Direct children range of every joint, in level order.
+	std::vector<JointRange> child_ranges_;
 };
\ No newline at end of file
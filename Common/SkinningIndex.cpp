@@ -0,0 +1,52 @@
+#include "SkinningIndex.h"
+
+SkinningIndex::SkinningIndex()
+	: m_vertex_count(0)
+{
+	m_offsets.push_back(0);
+}
+
+bool SkinningIndex::Build(const Mesh::Part& _part, int _num_joints)
+{
+	const int vertex_count = _part.vertex_count();
+	const int influences_count = _part.influences_count();
+
+	for (uint16_t joint : _part.joint_indices)
+	{
+		if (joint >= _num_joints)
+		{
+			return false;
+		}
+	}
+
+	// First pass builds ranges per joint, the second one flattens them.
+	std::vector<std::vector<Range>> ranges(_num_joints);
+	for (int v = 0; v < vertex_count; ++v)
+	{
+		for (int j = 0; j < influences_count; ++j)
+		{
+			std::vector<Range>& joint_ranges = ranges[_part.joint_indices[v * influences_count + j]];
+			if (!joint_ranges.empty() && joint_ranges.back().end >= v)
+			{
+				// A joint can be repeated for a vertex, hence the >=.
+				joint_ranges.back().end = v + 1;
+			}
+			else
+			{
+				joint_ranges.push_back({ v, v + 1 });
+			}
+		}
+	}
+
+	m_vertex_count = vertex_count;
+	m_offsets.resize(_num_joints + 1);
+	m_ranges.clear();
+	for (int i = 0; i < _num_joints; ++i)
+	{
+		m_offsets[i] = static_cast<int>(m_ranges.size());
+		m_ranges.insert(m_ranges.end(), ranges[i].begin(), ranges[i].end());
+	}
+	m_offsets[_num_joints] = static_cast<int>(m_ranges.size());
+
+	return true;
+}
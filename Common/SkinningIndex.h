@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Mesh.h"
+#include "span.h"
+
+// Maps every joint of a mesh part to the ranges of vertices it influences, so
+// that SkinningJob can skin only the vertices affected by the joints that
+// changed. Joints are the palette indices used by Mesh::Part::joint_indices.
+// Ranges are built by extending the last range of a joint while its vertices
+// are consecutive, so the index is compact for parts sorted by dominant joint
+// (see MeshOptimizeJob).
+class SkinningIndex
+{
+public:
+	// A range of vertices [begin,end[.
+	struct Range
+	{
+		int begin;
+		int end;
+	};
+
+	SkinningIndex();
+
+	// Builds the index of _part, whose joint indices must be lower than
+	// _num_joints (usually Mesh::num_joints()). Every influence is indexed,
+	// including the ones with a zero weight.
+	// Returns false if a joint index is out of range.
+	bool Build(const Mesh::Part& _part, int _num_joints);
+
+	// Returns the number of joints of the index.
+	int num_joints() const { return static_cast<int>(m_offsets.size()) - 1; }
+
+	// Returns the number of vertices of the indexed part.
+	int vertex_count() const { return m_vertex_count; }
+
+	// Returns the ranges of vertices influenced by _joint, sorted by increasing
+	// begin, without overlap.
+	span<const Range> ranges(int _joint) const
+	{
+		return { m_ranges.data() + m_offsets[_joint], m_ranges.data() + m_offsets[_joint + 1] };
+	}
+
+private:
+	int m_vertex_count;
+
+	// Ranges of joint i are stored in [m_offsets[i],m_offsets[i+1][.
+	std::vector<int> m_offsets;
+	std::vector<Range> m_ranges;
+};
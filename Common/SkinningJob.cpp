@@ -1,7 +1,19 @@
 #include "SkinningJob.h"
+#include "../Math/SimdMath.h"
+#include "../System/ThreadPool.h"
+#include "SkinningIndex.h"
+#include "Skeleton.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
 
 SkinningJob::SkinningJob()
 	: vertex_count(0),
+	thread_pool(nullptr),
+	vertices_per_task(kDefaultVerticesPerTask),
+	skinning_index(nullptr),
 	influences_count(0),
 	joint_indices_stride(0),
 	joint_weights_stride(0),
@@ -10,7 +22,36 @@ SkinningJob::SkinningJob()
 	in_tangents_stride(0),
 	out_positions_stride(0),
 	out_normals_stride(0),
-	out_tangents_stride(0) {}
+	out_tangents_stride(0),
+	output_layout(kAoS),
+	out_half_normals_stride(0),
+	out_half_tangents_stride(0),
+	in_quantized_positions_stride(0),
+	positions_offset(0.f),
+	positions_scale(0.f),
+	in_quantized_normals_stride(0),
+	in_quantized_tangents_stride(0),
+	quantized_joint_weights_stride(0) {}
+
+namespace
+{
+	// Tests that an output range can store vertex_count vertices of 3
+	// components, according to the output layout.
+	template <typename _Ty>
+	bool ValidOutput(const span<_Ty>& _output, size_t _stride, int _vertex_count, bool _soa)
+	{
+		if (_output.empty())
+		{
+			return false;
+		}
+		if (_vertex_count == 0)
+		{
+			return true;
+		}
+		const size_t cpnt_stride = _soa ? _stride * _vertex_count : sizeof(_Ty);
+		return _output.size_bytes() >= _stride * (_vertex_count - 1) + cpnt_stride * 2 + sizeof(_Ty);
+	}
+}  // namespace
 
 bool SkinningJob::Validate() const 
 {
@@ -20,8 +61,26 @@ bool SkinningJob::Validate() const
 	// Checks influences bounds.
 	valid &= influences_count > 0;
 
-	// Checks joints matrices, required.
-	valid &= !joint_matrices.empty();
+	// Checks parallel tasks size.
+	valid &= thread_pool == nullptr || vertices_per_task > 0;
+
+	// Checks incremental skinning index and bitset.
+	if (!changed_joints.empty()) {
+		valid &= skinning_index != nullptr &&
+			skinning_index->vertex_count() == vertex_count &&
+			skinning_index->num_joints() <= Skeleton::kMaxJoints &&
+			changed_joints.size() * 32 >= static_cast<size_t>(skinning_index->num_joints());
+	}
+
+	// Checks joints matrices or dual quaternions, one of them is required.
+	valid &= !joint_matrices.empty() || !joint_dual_quaternions.empty();
+
+	// Checks inverse transpose matrices, they come with their bitset.
+	valid &= joint_inverse_transpose_matrices.empty() == non_uniform_joints.empty();
+	if (!joint_inverse_transpose_matrices.empty()) {
+		valid &= joint_inverse_transpose_matrices.size() >= joint_matrices.size();
+		valid &= non_uniform_joints.size() * 32 >= joint_inverse_transpose_matrices.size();
+	}
 
 	// Prepares local variables used to compute buffer size.
 	const int vertex_count_minus_1 = vertex_count > 0 ? vertex_count - 1 : 0;
@@ -32,124 +91,842 @@ bool SkinningJob::Validate() const
 		joint_indices_stride * vertex_count_minus_1 +
 		sizeof(uint16_t) * influences_count * vertex_count_at_least_1;
 
+	// Quantized inputs are used if quantized positions are provided.
+	const bool quantized = !in_quantized_positions.empty();
+
 	// Checks weights, required if influences_count > 1.
 	if (influences_count != 1) {
-		valid &=
-			joint_weights.size_bytes() >=
-			joint_weights_stride * vertex_count_minus_1 +
-			sizeof(float) * (influences_count - 1) * vertex_count_at_least_1;
+		if (quantized) {
+			valid &=
+				quantized_joint_weights.size_bytes() >=
+				quantized_joint_weights_stride * vertex_count_minus_1 +
+				sizeof(uint8_t) * (influences_count - 1) * vertex_count_at_least_1;
+		}
+		else {
+			valid &=
+				joint_weights.size_bytes() >=
+				joint_weights_stride * vertex_count_minus_1 +
+				sizeof(float) * (influences_count - 1) * vertex_count_at_least_1;
+		}
 	}
 
 	// Checks positions, mandatory.
-	valid &= in_positions.size_bytes() >=
-		in_positions_stride * vertex_count_minus_1 +
-		sizeof(float) * 3 * vertex_count_at_least_1;
-	valid &= !out_positions.empty();
-	valid &= out_positions.size_bytes() >=
-		out_positions_stride * vertex_count_minus_1 +
-		sizeof(float) * 3 * vertex_count_at_least_1;
+	if (quantized) {
+		valid &= in_quantized_positions.size_bytes() >=
+			in_quantized_positions_stride * vertex_count_minus_1 +
+			sizeof(uint16_t) * 3 * vertex_count_at_least_1;
+	}
+	else {
+		valid &= in_positions.size_bytes() >=
+			in_positions_stride * vertex_count_minus_1 +
+			sizeof(float) * 3 * vertex_count_at_least_1;
+	}
+	const bool soa = output_layout == kSoA;
+	valid &= output_layout == kAoS || output_layout == kSoA;
+	valid &= ValidOutput(out_positions, out_positions_stride, vertex_count, soa);
 
 	// Checks normals, optional.
-	if (!in_normals.empty()) {
-		valid &= in_normals.size_bytes() >=
-			in_normals_stride * vertex_count_minus_1 +
-			sizeof(float) * 3 * vertex_count_at_least_1;
-		valid &= !out_normals.empty();
-		valid &= out_normals.size_bytes() >=
-			out_normals_stride * vertex_count_minus_1 +
-			sizeof(float) * 3 * vertex_count_at_least_1;
+	if (quantized ? !in_quantized_normals.empty() : !in_normals.empty()) {
+		if (quantized) {
+			valid &= in_quantized_normals.size_bytes() >=
+				in_quantized_normals_stride * vertex_count_minus_1 +
+				sizeof(int16_t) * 2 * vertex_count_at_least_1;
+		}
+		else {
+			valid &= in_normals.size_bytes() >=
+				in_normals_stride * vertex_count_minus_1 +
+				sizeof(float) * 3 * vertex_count_at_least_1;
+		}
+		valid &= out_half_normals.empty()
+			? ValidOutput(out_normals, out_normals_stride, vertex_count, soa)
+			: ValidOutput(out_half_normals, out_half_normals_stride, vertex_count, soa);
 
 		// Checks tangents, optional but requires normals.
-		if (!in_tangents.empty()) {
-			valid &= in_tangents.size_bytes() >=
-				in_tangents_stride * vertex_count_minus_1 +
-				sizeof(float) * 3 * vertex_count_at_least_1;
-			valid &= !out_tangents.empty();
-			valid &= out_tangents.size_bytes() >=
-				out_tangents_stride * vertex_count_minus_1 +
-				sizeof(float) * 3 * vertex_count_at_least_1;
+		if (quantized ? !in_quantized_tangents.empty() : !in_tangents.empty()) {
+			if (quantized) {
+				valid &= in_quantized_tangents.size_bytes() >=
+					in_quantized_tangents_stride * vertex_count_minus_1 +
+					sizeof(int16_t) * 2 * vertex_count_at_least_1;
+			}
+			else {
+				valid &= in_tangents.size_bytes() >=
+					in_tangents_stride * vertex_count_minus_1 +
+					sizeof(float) * 3 * vertex_count_at_least_1;
+			}
+			valid &= out_half_tangents.empty()
+				? ValidOutput(out_tangents, out_tangents_stride, vertex_count, soa)
+				: ValidOutput(out_half_tangents, out_half_tangents_stride, vertex_count, soa);
 		}
 	}
 	else {
 		// Tangents are not supported if normals are not there.
-		valid &= in_tangents.empty();
+		valid &= quantized ? in_quantized_tangents.empty() : in_tangents.empty();
 	}
 
 	return valid;
 }
 
-void Skinning(const SkinningJob& _job) 
+namespace
 {
-	bool bCalNormal = !_job.in_normals.empty();
-	bool bCalTangent = !_job.in_tangents.empty();
-	const size_t inf = _job.influences_count - 1;
-
-	const uint16_t* joint_indices = _job.joint_indices.begin();
-	const float* in_positions = _job.in_positions.begin();
-	float* out_positions = _job.out_positions.begin();
-	
-	const float* in_normals = bCalNormal ?  _job.in_normals.begin() : nullptr;
-	float* out_normals = bCalNormal ? _job.out_normals.begin() : nullptr;
-	const float* in_tangents = bCalTangent ? _job.in_tangents.begin() : nullptr;
-	float* out_tangents = bCalTangent ? _job.out_tangents.begin() : nullptr;
-	const float* joint_weights = inf>0 ? _job.joint_weights.begin() : nullptr;
-
-	const int loops = _job.vertex_count;
-	for (int i = 0; i < loops; ++i) 
-	{
-		float total_weight = 0.0f;
-		const Math::Vec4 in_p = Math::Vec4(in_positions[0], in_positions[1], in_positions[2], 1.0f);
-		Math::Vec3 out_p, out_n, out_t;
-		for (int j = 0; j <= inf; ++j)
-		{
-			float weight = 0.0f;
-			if (j == inf)
-				weight = 1.0 - total_weight;
+	// Weights are read through DecodeWeight, whatever their storage format.
+	FORCEINLINE float DecodeWeight(float _weight) { return _weight; }
+
+	FORCEINLINE float DecodeWeight(uint8_t _weight) { return _weight * (1.f / 255.f); }
+
+	// Vertex inputs read from float ranges, returned in place.
+	struct FloatInput
+	{
+		explicit FloatInput(const SkinningJob& _job) : job(_job) {}
+
+		FORCEINLINE const float* Weights(int _i) const
+		{
+			return PointerStride(job.joint_weights.begin(), job.joint_weights_stride * _i);
+		}
+
+		FORCEINLINE const float* Position(int _i)
+		{
+			return PointerStride(job.in_positions.begin(), job.in_positions_stride * _i);
+		}
+
+		FORCEINLINE const float* Normal(int _i)
+		{
+			return PointerStride(job.in_normals.begin(), job.in_normals_stride * _i);
+		}
+
+		FORCEINLINE const float* Tangent(int _i)
+		{
+			return PointerStride(job.in_tangents.begin(), job.in_tangents_stride * _i);
+		}
+
+		const SkinningJob& job;
+	};
+
+	// Vertex inputs decoded from quantized ranges, see Mesh::QuantizedPart.
+	// Decoded attributes are returned in a buffer that's valid until the next
+	// call.
+	struct QuantizedInput
+	{
+		explicit QuantizedInput(const SkinningJob& _job) : job(_job) {}
+
+		FORCEINLINE const uint8_t* Weights(int _i) const
+		{
+			return PointerStride(job.quantized_joint_weights.begin(), job.quantized_joint_weights_stride * _i);
+		}
+
+		FORCEINLINE const float* Position(int _i)
+		{
+			const uint16_t* q = PointerStride(job.in_quantized_positions.begin(), job.in_quantized_positions_stride * _i);
+			decoded[0] = job.positions_offset.x + q[0] * job.positions_scale.x;
+			decoded[1] = job.positions_offset.y + q[1] * job.positions_scale.y;
+			decoded[2] = job.positions_offset.z + q[2] * job.positions_scale.z;
+			return decoded;
+		}
+
+		FORCEINLINE const float* Normal(int _i)
+		{
+			return Octahedral(PointerStride(job.in_quantized_normals.begin(), job.in_quantized_normals_stride * _i));
+		}
+
+		FORCEINLINE const float* Tangent(int _i)
+		{
+			return Octahedral(PointerStride(job.in_quantized_tangents.begin(), job.in_quantized_tangents_stride * _i));
+		}
+
+		// Unfolds the octahedron, the lower hemisphere being folded over the
+		// diagonals by the encoder.
+		FORCEINLINE const float* Octahedral(const int16_t* _q)
+		{
+			float x = _q[0] * (1.f / 32767.f);
+			float y = _q[1] * (1.f / 32767.f);
+			const float z = 1.f - fabsf(x) - fabsf(y);
+			const float t = Math::Max(-z, 0.f);
+			x -= copysignf(t, x);
+			y -= copysignf(t, y);
+			const float inv_len = 1.f / sqrtf(x * x + y * y + z * z);
+			decoded[0] = x * inv_len;
+			decoded[1] = y * inv_len;
+			decoded[2] = z * inv_len;
+			return decoded;
+		}
+
+		const SkinningJob& job;
+		float decoded[3];
+	};
+
+	// Outputs 3 floats per attribute and vertex, in place. Kernels write to
+	// the returned pointer, then call Store.
+	struct FloatOutput
+	{
+		explicit FloatOutput(const SkinningJob& _job) : job(_job) {}
+
+		FORCEINLINE float* Position(int _i)
+		{
+			return PointerStride(job.out_positions.begin(), job.out_positions_stride * _i);
+		}
+
+		FORCEINLINE float* Normal(int _i)
+		{
+			return PointerStride(job.out_normals.begin(), job.out_normals_stride * _i);
+		}
+
+		FORCEINLINE float* Tangent(int _i)
+		{
+			return PointerStride(job.out_tangents.begin(), job.out_tangents_stride * _i);
+		}
+
+		FORCEINLINE void StorePosition(int) {}
+		FORCEINLINE void StoreNormal(int) {}
+		FORCEINLINE void StoreTangent(int) {}
+
+		const SkinningJob& job;
+	};
+
+	// Outputs according to the job output layout and formats. Kernels write to
+	// a temporary buffer, which is then scattered by Store.
+	struct LayoutOutput
+	{
+		explicit LayoutOutput(const SkinningJob& _job)
+			: job(_job),
+			soa(_job.output_layout == SkinningJob::kSoA) {}
+
+		FORCEINLINE float* Position(int) { return transformed; }
+		FORCEINLINE float* Normal(int) { return transformed; }
+		FORCEINLINE float* Tangent(int) { return transformed; }
+
+		FORCEINLINE void StorePosition(int _i)
+		{
+			Write(job.out_positions.begin(), job.out_positions_stride, _i);
+		}
+
+		FORCEINLINE void StoreNormal(int _i)
+		{
+			if (job.out_half_normals.empty())
+			{
+				Write(job.out_normals.begin(), job.out_normals_stride, _i);
+			}
+			else
+			{
+				Write(job.out_half_normals.begin(), job.out_half_normals_stride, _i);
+			}
+		}
+
+		FORCEINLINE void StoreTangent(int _i)
+		{
+			if (job.out_half_tangents.empty())
+			{
+				Write(job.out_tangents.begin(), job.out_tangents_stride, _i);
+			}
 			else
 			{
-				total_weight += joint_weights[j];
-				weight = joint_weights[j];
+				Write(job.out_half_tangents.begin(), job.out_half_tangents_stride, _i);
+			}
+		}
+
+		// Component c of vertex i is stored at _stride * i + cpnt_stride * c.
+		template <typename _Ty>
+		FORCEINLINE void Write(_Ty* _out, size_t _stride, int _i) const
+		{
+			const size_t cpnt_stride = soa ? _stride * job.vertex_count : sizeof(_Ty);
+			_Ty* out = PointerStride(_out, _stride * _i);
+			for (int c = 0; c < 3; ++c)
+			{
+				*PointerStride(out, cpnt_stride * c) = Convert(transformed[c], out);
+			}
+		}
+
+		static FORCEINLINE float Convert(float _f, const float*) { return _f; }
+		static FORCEINLINE uint16_t Convert(float _f, const uint16_t*) { return Math::FloatToHalf(_f); }
+
+		const SkinningJob& job;
+		const bool soa;
+		float transformed[3];
+	};
+
+	// Tests if any of the joints influencing a vertex has a non-uniform scale,
+	// in which case its normal requires inverse transpose matrices.
+	FORCEINLINE bool NonUniform(const SkinningJob& _job, const uint16_t* _indices, int _influences)
+	{
+		const uint32_t* bits = _job.non_uniform_joints.begin();
+		for (int j = 0; j < _influences; ++j)
+		{
+			if (bits[_indices[j] / 32] & (1u << (_indices[j] % 32)))
+			{
+				return true;
 			}
-			const uint16_t ij = joint_indices[j];
-			const Math::Mat4& m = _job.joint_matrices[ij];
+		}
+		return false;
+	}
 
-			out_p += (in_p * m).XYZ() * weight;
+#if MATH_SIMD_SSE2
+	using Math::SimdFloat4;
 
-			if (bCalNormal)
+	// Linear blend skinning. The matrices of the joints influencing a vertex are
+	// weighted before transforming anything, so that positions, normals and
+	// tangents are then transformed once whatever the number of influences.
+	struct MatrixBlending
+	{
+		typedef Math::Mat4 Joint;
+
+		static const Joint* Palette(const SkinningJob& _job) { return _job.joint_matrices.begin(); }
+
+		// The weight of the last joint is restored from the others, as weights
+		// are normalized. _Influences is the compile time number of influences,
+		// or 0 if it's only known at runtime (_influences).
+		template <int _Influences, typename _Weight>
+		FORCEINLINE void Blend(const Joint* _joints, const uint16_t* _indices,
+			const _Weight* _weights, int _influences)
+		{
+			const int influences = _Influences > 0 ? _Influences : _influences;
+			const float* m0 = _joints[_indices[0]].m;
+			if (influences == 1)
+			{
+				rows[0] = Math::simd::LoadPtrU(m0 + 0);
+				rows[1] = Math::simd::LoadPtrU(m0 + 4);
+				rows[2] = Math::simd::LoadPtrU(m0 + 8);
+				rows[3] = Math::simd::LoadPtrU(m0 + 12);
+				return;
+			}
+
+			const SimdFloat4 w0 = Math::simd::Load1(DecodeWeight(_weights[0]));
+			SimdFloat4 remaining = _mm_sub_ps(Math::simd::One(), w0);
+			for (int r = 0; r < 4; ++r)
+			{
+				rows[r] = _mm_mul_ps(Math::simd::LoadPtrU(m0 + r * 4), w0);
+			}
+			for (int j = 1; j < influences - 1; ++j)
 			{
-				const Math::Vec4 in_n = Math::Vec4(in_normals[0], in_normals[1], in_normals[2], 0.0f);
-				out_n += (in_n * m).XYZ() * weight;
+				const SimdFloat4 w = Math::simd::Load1(DecodeWeight(_weights[j]));
+				remaining = _mm_sub_ps(remaining, w);
+				const float* m = _joints[_indices[j]].m;
+				for (int r = 0; r < 4; ++r)
+				{
+					rows[r] = Math::simd::MAdd(Math::simd::LoadPtrU(m + r * 4), w, rows[r]);
+				}
 			}
-			if (bCalTangent)
+			const float* ml = _joints[_indices[influences - 1]].m;
+			for (int r = 0; r < 4; ++r)
 			{
-				const Math::Vec4 in_t = Math::Vec4(in_tangents[0], in_tangents[1], in_tangents[2], 0.0f);
-				out_t += (in_t * m).XYZ() * weight;
+				rows[r] = Math::simd::MAdd(Math::simd::LoadPtrU(ml + r * 4), remaining, rows[r]);
 			}
 		}
-		out_positions[0] = out_p.x; out_positions[1] = out_p.y; out_positions[2] = out_p.z;
-		if (bCalNormal)
-			out_normals[0] = out_n.x, out_normals[1] = out_n.y, out_normals[2] = out_n.z;
-		if (bCalTangent)
-			out_tangents[0] = out_t.x, out_tangents[1] = out_t.y, out_tangents[2] = out_t.z;
 
-		if (i == loops - 1)
-			break;
+		// Transforms a point the row vector way, v * m.
+		FORCEINLINE SimdFloat4 TransformPoint(SimdFloat4 _v) const
+		{
+			return Math::simd::MAdd(Math::simd::Splat<0>(_v), rows[0],
+				Math::simd::MAdd(Math::simd::Splat<1>(_v), rows[1],
+					Math::simd::MAdd(Math::simd::Splat<2>(_v), rows[2], rows[3])));
+		}
 
-		joint_indices = reinterpret_cast<const uint16_t*>(reinterpret_cast<uintptr_t>(joint_indices) + _job.joint_indices_stride);
-		in_positions = reinterpret_cast<const float*>(reinterpret_cast<uintptr_t>(in_positions) + _job.in_positions_stride);
-		out_positions = reinterpret_cast<float*>(reinterpret_cast<uintptr_t>(out_positions) + _job.out_positions_stride);
-		if (bCalNormal)
+		// Transforms a vector, ignoring the translation row.
+		FORCEINLINE SimdFloat4 TransformVector(SimdFloat4 _v) const
 		{
-			in_normals = reinterpret_cast<const float*>(reinterpret_cast<uintptr_t>(in_normals) + _job.in_normals_stride);
-			out_normals = reinterpret_cast<float*>(reinterpret_cast<uintptr_t>(out_normals) + _job.out_normals_stride);
+			return Math::simd::MAdd(Math::simd::Splat<0>(_v), rows[0],
+				Math::simd::MAdd(Math::simd::Splat<1>(_v), rows[1],
+					_mm_mul_ps(Math::simd::Splat<2>(_v), rows[2])));
 		}
-		if (bCalTangent)
+
+		SimdFloat4 rows[4];
+	};
+
+	// Dual quaternion skinning. 8 floats are blended per influence, and the
+	// result is renormalized, which preserves volumes around twisting joints.
+	struct DualQuaternionBlending
+	{
+		typedef Math::DualQuaternion Joint;
+
+		static const Joint* Palette(const SkinningJob& _job) { return _job.joint_dual_quaternions.begin(); }
+
+		// Quaternions are flipped to the hemisphere of the first influence, so
+		// that blending follows the shortest path.
+		template <int _Influences, typename _Weight>
+		FORCEINLINE void Blend(const Joint* _joints, const uint16_t* _indices,
+			const _Weight* _weights, int _influences)
 		{
-			in_tangents = reinterpret_cast<const float*>(reinterpret_cast<uintptr_t>(in_tangents) + _job.in_tangents_stride);
-			out_tangents = reinterpret_cast<float*>(reinterpret_cast<uintptr_t>(out_tangents) + _job.out_tangents_stride);
+			const int influences = _Influences > 0 ? _Influences : _influences;
+			const float* dq0 = _joints[_indices[0]].GetPtr();
+			const SimdFloat4 real0 = Math::simd::LoadPtrU(dq0);
+			const SimdFloat4 dual0 = Math::simd::LoadPtrU(dq0 + 4);
+			if (influences == 1)
+			{
+				// Palette dual quaternions are already normalized.
+				Setup(real0, dual0);
+				return;
+			}
+
+			const SimdFloat4 sign = _mm_set1_ps(-0.f);
+			const SimdFloat4 w0 = Math::simd::Load1(DecodeWeight(_weights[0]));
+			SimdFloat4 remaining = _mm_sub_ps(Math::simd::One(), w0);
+			SimdFloat4 real = _mm_mul_ps(real0, w0);
+			SimdFloat4 dual = _mm_mul_ps(dual0, w0);
+			for (int j = 1; j < influences; ++j)
+			{
+				SimdFloat4 w = remaining;
+				if (j < influences - 1)
+				{
+					w = Math::simd::Load1(DecodeWeight(_weights[j]));
+					remaining = _mm_sub_ps(remaining, w);
+				}
+				const float* dq = _joints[_indices[j]].GetPtr();
+				const SimdFloat4 r = Math::simd::LoadPtrU(dq);
+				const SimdFloat4 d = Math::simd::LoadPtrU(dq + 4);
+				const SimdFloat4 opposite =
+					_mm_cmplt_ps(Math::simd::Dot4(real0, r), Math::simd::Zero());
+				w = _mm_xor_ps(w, _mm_and_ps(opposite, sign));
+				real = Math::simd::MAdd(r, w, real);
+				dual = Math::simd::MAdd(d, w, dual);
+			}
+
+			const SimdFloat4 inv_len =
+				_mm_div_ps(Math::simd::One(), _mm_sqrt_ps(Math::simd::Dot4(real, real)));
+			Setup(_mm_mul_ps(real, inv_len), _mm_mul_ps(dual, inv_len));
+		}
+
+		// Stores the rotation, and extracts the translation once for all the
+		// attributes: translation = 2 * dual * conjugate(real).
+		FORCEINLINE void Setup(SimdFloat4 _real, SimdFloat4 _dual)
+		{
+			real = _real;
+			real_w = Math::simd::Splat<3>(_real);
+			const SimdFloat4 t = _mm_add_ps(
+				_mm_sub_ps(_mm_mul_ps(real_w, _dual), _mm_mul_ps(Math::simd::Splat<3>(_dual), _real)),
+				Math::simd::Cross3(_real, _dual));
+			translation = _mm_add_ps(t, t);
+		}
+
+		// v + 2 * cross(real.xyz, cross(real.xyz, v) + real.w * v)
+		FORCEINLINE SimdFloat4 TransformVector(SimdFloat4 _v) const
+		{
+			const SimdFloat4 t = Math::simd::MAdd(real_w, _v, Math::simd::Cross3(real, _v));
+			const SimdFloat4 c = Math::simd::Cross3(real, t);
+			return _mm_add_ps(_v, _mm_add_ps(c, c));
+		}
+
+		FORCEINLINE SimdFloat4 TransformPoint(SimdFloat4 _v) const
+		{
+			return _mm_add_ps(TransformVector(_v), translation);
+		}
+
+		SimdFloat4 real;
+		SimdFloat4 real_w;
+		SimdFloat4 translation;
+	};
+
+	// Skinning kernel, specialized for a blending method, a number of
+	// influences (0 meaning any) and the set of transformed vertex attributes.
+	// Only 3 floats are read and written per attribute, so interleaved buffers
+	// are supported. Inputs are read through _Input, which decodes quantized
+	// formats, and written through _Output, which handles output layouts and
+	// formats. If _InverseTranspose is true, normals of the vertices influenced
+	// by a non-uniformly scaled joint are transformed by blended inverse
+	// transpose matrices. Vertices in range [_begin,_end[ are processed.
+	template <typename _Blending, typename _Input, typename _Output, bool _InverseTranspose, int _Influences, bool _Normals, bool _Tangents>
+	void SkinningKernel(const SkinningJob& _job, int _begin, int _end)
+	{
+		const typename _Blending::Joint* joints = _Blending::Palette(_job);
+		const int influences = _Influences > 0 ? _Influences : _job.influences_count;
+		_Input input(_job);
+		_Output output(_job);
+		for (int i = _begin; i < _end; ++i)
+		{
+			const uint16_t* indices = PointerStride(_job.joint_indices.begin(), _job.joint_indices_stride * i);
+			_Blending blending;
+			blending.template Blend<_Influences>(joints, indices, input.Weights(i), _job.influences_count);
+
+			const SimdFloat4 in_p = Math::simd::Load3PtrU(input.Position(i));
+			Math::simd::Store3PtrU(blending.TransformPoint(in_p), output.Position(i));
+			output.StorePosition(i);
+
+			if (_Normals)
+			{
+				const SimdFloat4 in_n = Math::simd::Load3PtrU(input.Normal(i));
+				SimdFloat4 out_n;
+				if (_InverseTranspose && NonUniform(_job, indices, influences))
+				{
+					MatrixBlending normal_blending;
+					normal_blending.template Blend<_Influences>(_job.joint_inverse_transpose_matrices.begin(),
+						indices, input.Weights(i), _job.influences_count);
+					out_n = normal_blending.TransformVector(in_n);
+				}
+				else
+				{
+					out_n = blending.TransformVector(in_n);
+				}
+				Math::simd::Store3PtrU(out_n, output.Normal(i));
+				output.StoreNormal(i);
+			}
+			if (_Tangents)
+			{
+				const SimdFloat4 in_t = Math::simd::Load3PtrU(input.Tangent(i));
+				Math::simd::Store3PtrU(blending.TransformVector(in_t), output.Tangent(i));
+				output.StoreTangent(i);
+			}
 		}
 	}
-}
+#else  // MATH_SIMD_SSE2
+	// Scalar fallback, following the same algorithms as the SIMD kernels.
+	struct MatrixBlending
+	{
+		typedef Math::Mat4 Joint;
+
+		static const Joint* Palette(const SkinningJob& _job) { return _job.joint_matrices.begin(); }
+
+		template <int _Influences, typename _Weight>
+		FORCEINLINE void Blend(const Joint* _joints, const uint16_t* _indices,
+			const _Weight* _weights, int _influences)
+		{
+			const int influences = _Influences > 0 ? _Influences : _influences;
+			if (influences == 1)
+			{
+				std::memcpy(rows, _joints[_indices[0]].m, sizeof(rows));
+				return;
+			}
+
+			float remaining = 1.f;
+			std::memset(rows, 0, sizeof(rows));
+			for (int j = 0; j < influences; ++j)
+			{
+				const float w = j < influences - 1 ? DecodeWeight(_weights[j]) : remaining;
+				remaining -= w;
+				const float* m = _joints[_indices[j]].m;
+				for (int k = 0; k < 16; ++k)
+				{
+					rows[k] += m[k] * w;
+				}
+			}
+		}
+
+		FORCEINLINE void Transform(const float* _in, float _w, float* _out) const
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				_out[c] = _in[0] * rows[c] + _in[1] * rows[4 + c] + _in[2] * rows[8 + c] + _w * rows[12 + c];
+			}
+		}
+
+		FORCEINLINE void TransformPoint(const float* _in, float* _out) const { Transform(_in, 1.f, _out); }
+
+		FORCEINLINE void TransformVector(const float* _in, float* _out) const { Transform(_in, 0.f, _out); }
+
+		float rows[16];
+	};
+
+	struct DualQuaternionBlending
+	{
+		typedef Math::DualQuaternion Joint;
+
+		static const Joint* Palette(const SkinningJob& _job) { return _job.joint_dual_quaternions.begin(); }
+
+		template <int _Influences, typename _Weight>
+		FORCEINLINE void Blend(const Joint* _joints, const uint16_t* _indices,
+			const _Weight* _weights, int _influences)
+		{
+			const int influences = _Influences > 0 ? _Influences : _influences;
+			const float* dq0 = _joints[_indices[0]].GetPtr();
+			if (influences == 1)
+			{
+				Setup(dq0, 1.f);
+				return;
+			}
+
+			// Math::Quaternion operators renormalize, so components are blended
+			// as plain floats.
+			float remaining = 1.f;
+			float dq[8] = {};
+			for (int j = 0; j < influences; ++j)
+			{
+				float w = j < influences - 1 ? DecodeWeight(_weights[j]) : remaining;
+				remaining -= w;
+				const float* dqj = _joints[_indices[j]].GetPtr();
+				if (dq0[0] * dqj[0] + dq0[1] * dqj[1] + dq0[2] * dqj[2] + dq0[3] * dqj[3] < 0.f)
+				{
+					w = -w;
+				}
+				for (int k = 0; k < 8; ++k)
+				{
+					dq[k] += dqj[k] * w;
+				}
+			}
+			Setup(dq, 1.f / sqrtf(dq[0] * dq[0] + dq[1] * dq[1] + dq[2] * dq[2] + dq[3] * dq[3]));
+		}
+
+		// Stores the normalized rotation, and extracts the translation once for
+		// all the attributes: translation = 2 * dual * conjugate(real).
+		FORCEINLINE void Setup(const float* _dq, float _scale)
+		{
+			real = Math::Vec3(_dq[0], _dq[1], _dq[2]) * _scale;
+			real_w = _dq[3] * _scale;
+			const Math::Vec3 dual = Math::Vec3(_dq[4], _dq[5], _dq[6]) * _scale;
+			const float dual_w = _dq[7] * _scale;
+			translation = (dual * real_w - real * dual_w + Math::CrossProduct(real, dual)) * 2.f;
+		}
+
+		FORCEINLINE Math::Vec3 Rotate(const float* _in) const
+		{
+			const Math::Vec3 v(_in[0], _in[1], _in[2]);
+			return v + Math::CrossProduct(real, Math::CrossProduct(real, v) + v * real_w) * 2.f;
+		}
+
+		FORCEINLINE void TransformPoint(const float* _in, float* _out) const
+		{
+			const Math::Vec3 out = Rotate(_in) + translation;
+			_out[0] = out.x, _out[1] = out.y, _out[2] = out.z;
+		}
+
+		FORCEINLINE void TransformVector(const float* _in, float* _out) const
+		{
+			const Math::Vec3 out = Rotate(_in);
+			_out[0] = out.x, _out[1] = out.y, _out[2] = out.z;
+		}
+
+		Math::Vec3 real;
+		float real_w;
+		Math::Vec3 translation;
+	};
+
+	template <typename _Blending, typename _Input, typename _Output, bool _InverseTranspose, int _Influences, bool _Normals, bool _Tangents>
+	void SkinningKernel(const SkinningJob& _job, int _begin, int _end)
+	{
+		const typename _Blending::Joint* joints = _Blending::Palette(_job);
+		const int influences = _Influences > 0 ? _Influences : _job.influences_count;
+		_Input input(_job);
+		_Output output(_job);
+		for (int i = _begin; i < _end; ++i)
+		{
+			const uint16_t* indices = PointerStride(_job.joint_indices.begin(), _job.joint_indices_stride * i);
+			_Blending blending;
+			blending.template Blend<_Influences>(joints, indices, input.Weights(i), _job.influences_count);
+
+			blending.TransformPoint(input.Position(i), output.Position(i));
+			output.StorePosition(i);
+			if (_Normals)
+			{
+				float* out_n = output.Normal(i);
+				if (_InverseTranspose && NonUniform(_job, indices, influences))
+				{
+					MatrixBlending normal_blending;
+					normal_blending.template Blend<_Influences>(_job.joint_inverse_transpose_matrices.begin(),
+						indices, input.Weights(i), _job.influences_count);
+					normal_blending.TransformVector(input.Normal(i), out_n);
+				}
+				else
+				{
+					blending.TransformVector(input.Normal(i), out_n);
+				}
+				output.StoreNormal(i);
+			}
+			if (_Tangents)
+			{
+				blending.TransformVector(input.Tangent(i), output.Tangent(i));
+				output.StoreTangent(i);
+			}
+		}
+	}
+#endif  // MATH_SIMD_SSE2
+
+	typedef void (*SkinningFct)(const SkinningJob&, int, int);
+
+	// Kernels of a blending method, input and output formats, and normals
+	// transformation, indexed by influences count (0 for more than 4
+	// influences), and by transformed attributes: positions, +normals,
+	// +tangents.
+	template <typename _Blending, typename _Input, typename _Output, bool _InverseTranspose>
+	struct SkinningFcts
+	{
+		static const SkinningFct kFcts[5][3];
+	};
+
+	template <typename _Blending, typename _Input, typename _Output, bool _InverseTranspose>
+	const SkinningFct SkinningFcts<_Blending, _Input, _Output, _InverseTranspose>::kFcts[5][3] = {
+		{&SkinningKernel<_Blending, _Input, _Output, _InverseTranspose, 0, false, false>, &SkinningKernel<_Blending, _Input, _Output, _InverseTranspose, 0, true, false>, &SkinningKernel<_Blending, _Input, _Output, _InverseTranspose, 0, true, true>},
+		{&SkinningKernel<_Blending, _Input, _Output, _InverseTranspose, 1, false, false>, &SkinningKernel<_Blending, _Input, _Output, _InverseTranspose, 1, true, false>, &SkinningKernel<_Blending, _Input, _Output, _InverseTranspose, 1, true, true>},
+		{&SkinningKernel<_Blending, _Input, _Output, _InverseTranspose, 2, false, false>, &SkinningKernel<_Blending, _Input, _Output, _InverseTranspose, 2, true, false>, &SkinningKernel<_Blending, _Input, _Output, _InverseTranspose, 2, true, true>},
+		{&SkinningKernel<_Blending, _Input, _Output, _InverseTranspose, 3, false, false>, &SkinningKernel<_Blending, _Input, _Output, _InverseTranspose, 3, true, false>, &SkinningKernel<_Blending, _Input, _Output, _InverseTranspose, 3, true, true>},
+		{&SkinningKernel<_Blending, _Input, _Output, _InverseTranspose, 4, false, false>, &SkinningKernel<_Blending, _Input, _Output, _InverseTranspose, 4, true, false>, &SkinningKernel<_Blending, _Input, _Output, _InverseTranspose, 4, true, true>} };
+
+	// Selects the kernel matching job input and output formats.
+	template <typename _Blending, bool _InverseTranspose>
+	SkinningFct SelectKernel(const SkinningJob& _job, int _influences, int _attributes)
+	{
+		const bool quantized = !_job.in_quantized_positions.empty();
+		const bool layout = _job.output_layout != SkinningJob::kAoS ||
+			!_job.out_half_normals.empty() || !_job.out_half_tangents.empty();
+		if (quantized)
+		{
+			return layout
+				? SkinningFcts<_Blending, QuantizedInput, LayoutOutput, _InverseTranspose>::kFcts[_influences][_attributes]
+				: SkinningFcts<_Blending, QuantizedInput, FloatOutput, _InverseTranspose>::kFcts[_influences][_attributes];
+		}
+		return layout
+			? SkinningFcts<_Blending, FloatInput, LayoutOutput, _InverseTranspose>::kFcts[_influences][_attributes]
+			: SkinningFcts<_Blending, FloatInput, FloatOutput, _InverseTranspose>::kFcts[_influences][_attributes];
+	}
+
+	// Walks the ranges of the changed joints by increasing begin, merging the
+	// ones that overlap or touch, so that shared vertices are skinned once.
+	// Ranges of every joint are already sorted, so they are merged from a heap
+	// of the next range of every changed joint. The heap lives on the stack, so
+	// nothing is allocated per frame.
+	struct ChangedRanges
+	{
+		explicit ChangedRanges(const SkinningJob& _job)
+			: count(0)
+		{
+			const SkinningIndex& index = *_job.skinning_index;
+			for (int i = 0; i < index.num_joints(); ++i)
+			{
+				if (_job.changed_joints[i / 32] & (1u << (i % 32)))
+				{
+					const span<const SkinningIndex::Range> joint_ranges = index.ranges(i);
+					if (!joint_ranges.empty())
+					{
+						cursors[count++] = { joint_ranges.begin(), joint_ranges.end() };
+					}
+				}
+			}
+			std::make_heap(cursors, cursors + count, &Later);
+		}
+
+		// Gets the next merged range. Returns false once all ranges are walked.
+		bool Next(SkinningIndex::Range* _range)
+		{
+			if (count == 0)
+			{
+				return false;
+			}
+			*_range = *cursors[0].range;
+			Pop();
+			while (count > 0 && cursors[0].range->begin <= _range->end)
+			{
+				_range->end = Math::Max(_range->end, cursors[0].range->end);
+				Pop();
+			}
+			return true;
+		}
+
+	private:
+		struct Cursor
+		{
+			const SkinningIndex::Range* range;
+			const SkinningIndex::Range* end;
+		};
+
+		// Heap ordering, the lowest begin first.
+		static bool Later(const Cursor& _a, const Cursor& _b)
+		{
+			return _a.range->begin > _b.range->begin;
+		}
+
+		// Moves the first cursor to its next range.
+		void Pop()
+		{
+			std::pop_heap(cursors, cursors + count, &Later);
+			Cursor& cursor = cursors[count - 1];
+			if (++cursor.range == cursor.end)
+			{
+				--count;
+			}
+			else
+			{
+				std::push_heap(cursors, cursors + count, &Later);
+			}
+		}
+
+		Cursor cursors[Skeleton::kMaxJoints];
+		int count;
+	};
+
+	// Skins the vertices influenced by changed joints only.
+	void SkinChangedVertices(const SkinningJob& _job, SkinningFct _fct)
+	{
+		SkinningIndex::Range range;
+		if (_job.thread_pool == nullptr)
+		{
+			ChangedRanges ranges(_job);
+			while (ranges.Next(&range))
+			{
+				_fct(_job, range.begin, range.end);
+			}
+			return;
+		}
+
+		// Merged ranges are split in tasks of at most vertices_per_task vertices.
+		// Tasks are counted by a first walk, then every task takes the next one
+		// from a shared walk.
+		const int per_task = _job.vertices_per_task;
+		int num_tasks = 0;
+		{
+			ChangedRanges ranges(_job);
+			while (ranges.Next(&range))
+			{
+				num_tasks += (range.end - range.begin + per_task - 1) / per_task;
+			}
+		}
+
+		ChangedRanges ranges(_job);
+		SkinningIndex::Range remaining = { 0, 0 };
+		std::mutex mutex;
+		_job.thread_pool->ParallelFor(num_tasks, [&](int)
+			{
+				SkinningIndex::Range task;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (remaining.begin == remaining.end)
+					{
+						ranges.Next(&remaining);
+					}
+					task.begin = remaining.begin;
+					task.end = Math::Min(remaining.begin + per_task, remaining.end);
+					remaining.begin = task.end;
+				}
+				_fct(_job, task.begin, task.end);
+			});
+	}
+
+	void Skinning(const SkinningJob& _job)
+	{
+		const int influences = _job.influences_count <= 4 ? _job.influences_count : 0;
+		const bool quantized = !_job.in_quantized_positions.empty();
+		const bool normals = quantized ? !_job.in_quantized_normals.empty() : !_job.in_normals.empty();
+		const bool tangents = quantized ? !_job.in_quantized_tangents.empty() : !_job.in_tangents.empty();
+		const int attributes = normals ? (tangents ? 2 : 1) : 0;
+		SkinningFct fct;
+		if (!_job.joint_dual_quaternions.empty())
+		{
+			fct = SelectKernel<DualQuaternionBlending, false>(_job, influences, attributes);
+		}
+		else if (!_job.joint_inverse_transpose_matrices.empty())
+		{
+			fct = SelectKernel<MatrixBlending, true>(_job, influences, attributes);
+		}
+		else
+		{
+			fct = SelectKernel<MatrixBlending, false>(_job, influences, attributes);
+		}
+
+		if (!_job.changed_joints.empty())
+		{
+			SkinChangedVertices(_job, fct);
+			return;
+		}
+
+		const int vertex_count = _job.vertex_count;
+		const int per_task = _job.vertices_per_task;
+		if (_job.thread_pool == nullptr || vertex_count <= per_task)
+		{
+			fct(_job, 0, vertex_count);
+			return;
+		}
+
+		// Ranges are disjoint, so tasks never write to the same vertex.
+		const int num_tasks = (vertex_count + per_task - 1) / per_task;
+		_job.thread_pool->ParallelFor(num_tasks, [&](int _task)
+			{
+				const int begin = _task * per_task;
+				fct(_job, begin, Math::Min(begin + per_task, vertex_count));
+			});
+	}
+}  // namespace
 
 // Implements job Run function.
 bool SkinningJob::Run() const 
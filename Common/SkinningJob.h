@@ -3,6 +3,12 @@
 #include "../Math/3DMath.h"
 #include "span.h"
 
+// Forward declares the pool used to run jobs in parallel.
+class ThreadPool;
+
+// Forward declares the joint to vertices index used by incremental skinning.
+class SkinningIndex;
+
 struct SkinningJob
 {
 	// Default constructor, initializes default values.
@@ -11,10 +17,18 @@ struct SkinningJob
 	// Validates job parameters.
 	// Returns true for a valid job, false otherwise:
 	// - if any range is invalid. See each range description.
+	// - if neither joint_matrices nor joint_dual_quaternions are provided.
 	// - if normals are provided but positions aren't.
 	// - if tangents are provided but normals aren't.
 	// - if no output is provided while an input is. For example, if input normals
 	// are provided, then output normals must also.
+	// - if thread_pool is provided and vertices_per_task isn't greater than 0.
+	// - if joint_inverse_transpose_matrices are provided without
+	// non_uniform_joints (or the opposite), or are less than joint_matrices.
+	// - if changed_joints is provided without a skinning_index matching
+	// vertex_count, or is too small for the index joints, or if the index has
+	// more than Skeleton::kMaxJoints joints.
+	// Quantized inputs replace float ones if in_quantized_positions is provided.
 	bool Validate() const;
 
 	// Runs job's skinning task.
@@ -27,6 +41,29 @@ struct SkinningJob
 	// least this number of vertices.
 	int vertex_count;
 
+	// Optional pool used to skin vertices in parallel. Vertices are split in
+	// contiguous ranges of vertices_per_task vertices, processed by the pool
+	// workers and the calling thread. Run() returns once all vertices are
+	// skinned. Every vertex is transformed the same way whatever the thread
+	// that processes it, so the output is identical to a single threaded run.
+	// Default nullptr runs the job on the calling thread only.
+	ThreadPool* thread_pool;
+
+	// Number of vertices per parallel task, default is kDefaultVerticesPerTask.
+	// Ranges should be big enough to amortize scheduling, and small enough to
+	// balance the work between threads while fitting in cache.
+	int vertices_per_task;
+	enum { kDefaultVerticesPerTask = 2048 };
+
+	// Optional incremental skinning. If changed_joints isn't empty, only the
+	// vertices influenced by the joints whose bit is set (bit i of word i / 32
+	// for palette joint i) are skinned, using skinning_index to find them. Other
+	// vertices are left untouched, so output buffers must be persistent and
+	// hold the result of a previous full skinning with the same inputs. See
+	// SkinningPaletteJob::changed_joints to compute the bitset.
+	const SkinningIndex* skinning_index;
+	span<const uint32_t> changed_joints;
+
 	// Maximum number of joints influencing each vertex. Must be greater than 0.
 	// The number of influences drives how joint_indices and joint_weights are
 	// sampled:
@@ -39,11 +76,24 @@ struct SkinningJob
 	// Array of matrices for each joint. Joint are indexed through indices array.
 	span<const Math::Mat4> joint_matrices;
 
-	// ÿؽڵĿѡתþ顣ṩתߺߣʹ joint_matrices 顣
-	// Ƥ˴ (http://www.glprogramming.com/red/appendixf.html) 任Żʱ任Ҫرע⡣
-	// £ȷı任ͨ任ı任תɵġκת󶼺ܺá
-	// ЩǿѡģΪǵļɱܸܺߣһƤ㷨гɱߵĴ·
+	// Optional array of dual quaternions for each joint, see
+	// DualQuaternionPaletteJob. If not empty, vertices are skinned by blending
+	// dual quaternions instead of joint_matrices, which aren't used. Dual
+	// quaternion skinning avoids the volume loss of linear blending around
+	// twisting joints, but doesn't support scale.
+	span<const Math::DualQuaternion> joint_dual_quaternions;
+
+	// Optional inverse transpose matrices of joint_matrices, used to transform
+	// normals. Normals are only correctly transformed by the matrices
+	// themselves if they don't have a non-uniform scale (or shearing). See
+	// InverseTransposeJob, which computes both these matrices and the
+	// non_uniform_joints bitset. Only the vertices influenced by a joint whose
+	// bit is set in non_uniform_joints blend inverse transpose matrices, others
+	// use the faster joint_matrices path. Both must be provided together, and
+	// are ignored for dual quaternion skinning, which doesn't support scale.
+	// Tangents are always transformed by joint_matrices.
 	span<const Math::Mat4> joint_inverse_transpose_matrices;
+	span<const uint32_t> non_uniform_joints;
 
 	// Array of joints indices. This array is used to indexes matrices in joints
 	// array.
@@ -103,4 +153,56 @@ struct SkinningJob
 	// Array length must be at least vertex_count * out_tangents_stride.
 	span<float> out_tangents;
 	size_t out_tangents_stride;
+
+	// Layout of the output ranges. Whatever the layout, attributes of a vertex
+	// can be interleaved in a single buffer by offsetting the begin of the
+	// output ranges and setting the same stride.
+	enum OutputLayout
+	{
+		// Components of a vertex are contiguous (x, y, z), and vertices are
+		// separated by the range stride. This is the default.
+		kAoS,
+		// Components are stored in separate blocks of vertex_count elements: all
+		// x, then all y, then all z. Elements of a block are separated by the
+		// range stride, which is usually the size of a single component.
+		kSoA,
+	};
+	OutputLayout output_layout;
+
+	// Optional half-precision output normals and tangents (3 uint16_t values per
+	// vertex, see Math::FloatToHalf), written instead of out_normals and
+	// out_tangents if not empty. Strides and layout follow the same rules as
+	// float outputs.
+	span<uint16_t> out_half_normals;
+	size_t out_half_normals_stride;
+	span<uint16_t> out_half_tangents;
+	size_t out_half_tangents_stride;
+
+	// Optional quantized inputs, see Mesh::QuantizedPart. If
+	// in_quantized_positions isn't empty, vertex attributes and weights are read
+	// and decoded from the quantized ranges below, and in_positions, in_normals,
+	// in_tangents and joint_weights aren't used. Strides and sizes follow the
+	// same rules as the float inputs.
+
+	// Input vertex positions (3 uint16_t values per vertex) array and stride.
+	// Positions are decoded as positions_offset + quantized * positions_scale.
+	span<const uint16_t> in_quantized_positions;
+	size_t in_quantized_positions_stride;
+	Math::Vec3 positions_offset;
+	Math::Vec3 positions_scale;
+
+	// Input vertex normals, octahedral encoded (2 int16_t values per vertex),
+	// array and stride.
+	span<const int16_t> in_quantized_normals;
+	size_t in_quantized_normals_stride;
+
+	// Input vertex tangents, octahedral encoded (2 int16_t values per vertex),
+	// array and stride.
+	span<const int16_t> in_quantized_tangents;
+	size_t in_quantized_tangents_stride;
+
+	// Joints weights, normalized to 8 bits (influences_count - 1 values per
+	// vertex), array and stride.
+	span<const uint8_t> quantized_joint_weights;
+	size_t quantized_joint_weights_stride;
 };
\ No newline at end of file
@@ -0,0 +1,285 @@
+#include "SkinningPaletteJob.h"
+#include "../Math/3DMath.h"
+#include "../Math/SimdMath.h"
+#include "Mesh.h"
+#include "Skeleton.h"
+#include "SimdAffine.h"
+
+#include <cstring>
+
+SkinningPaletteJob::SkinningPaletteJob()
+	: skeleton(nullptr),
+	root(nullptr) {}
+
+bool SkinningPaletteJob::Validate() const
+{
+	bool valid = true;
+
+	if (!skeleton)
+	{
+		return false;
+	}
+
+	const size_t num_joints = static_cast<size_t>(skeleton->num_joints());
+	const size_t num_meshes = meshes.size();
+
+	valid &= input.size() >= num_joints;
+	valid &= models.size() >= num_joints;
+	valid &= num_meshes <= kMaxMeshes;
+
+	for (const Mesh& mesh : meshes)
+	{
+		valid &= mesh.inverse_bind_poses.size() >= mesh.joint_remaps.size();
+		valid &= static_cast<size_t>(mesh.highest_joint_index()) < num_joints;
+	}
+
+	if (!affine_palettes.empty())
+	{
+		valid &= affine_palettes.size() == num_meshes;
+		for (size_t i = 0; valid && i < num_meshes; ++i)
+		{
+			valid &= affine_palettes[i].size() >= meshes[i].joint_remaps.size();
+		}
+	}
+	else
+	{
+		valid &= palettes.size() == num_meshes;
+		for (size_t i = 0; valid && i < num_meshes; ++i)
+		{
+			valid &= palettes[i].size() >= meshes[i].joint_remaps.size();
+		}
+	}
+
+	if (!changed_joints.empty())
+	{
+		valid &= changed_joints.size() == num_meshes;
+		for (size_t i = 0; valid && i < num_meshes; ++i)
+		{
+			valid &= changed_joints[i].size() * 32 >= meshes[i].joint_remaps.size();
+		}
+	}
+
+	return valid;
+}
+
+namespace
+{
+	// Returns true if both inverse bind poses are identical, in which case the
+	// skinning matrix computed for the first can be reused for the second.
+	bool SameBindPose(const Math::Mat4& _a, const Math::Mat4& _b)
+	{
+		return &_a == &_b || std::memcmp(_a.m, _b.m, sizeof(_a.m)) == 0;
+	}
+
+	// Updates the changed bit of palette entry _entry of mesh _mesh, if the job
+	// outputs changed joints.
+	void SetChanged(const SkinningPaletteJob& _job, size_t _mesh, size_t _entry, bool _changed)
+	{
+		if (_job.changed_joints.empty())
+		{
+			return;
+		}
+		uint32_t& word = _job.changed_joints[_mesh][_entry / 32];
+		const uint32_t bit = 1u << (_entry % 32);
+		word = _changed ? (word | bit) : (word & ~bit);
+	}
+
+#if MATH_SIMD_SSE2
+	using Math::SimdFloat4;
+	using internal::BuildSoaAffine;
+	using internal::Mat4Traits;
+
+	// Palettes are computed as Mat4 rows, see Mat4Traits. Store returns true if
+	// the output matrix was modified.
+	struct Mat4PaletteTraits
+	{
+		typedef Math::Mat4 Matrix;
+
+		static bool Store(const SimdFloat4 _rows[4], Matrix* _output)
+		{
+			const float* m = _output->m;
+			const SimdFloat4 changed = _mm_or_ps(
+				_mm_or_ps(_mm_cmpneq_ps(_rows[0], Math::simd::LoadPtrU(m + 0)),
+					_mm_cmpneq_ps(_rows[1], Math::simd::LoadPtrU(m + 4))),
+				_mm_or_ps(_mm_cmpneq_ps(_rows[2], Math::simd::LoadPtrU(m + 8)),
+					_mm_cmpneq_ps(_rows[3], Math::simd::LoadPtrU(m + 12))));
+			Mat4Traits::Store(_rows, _output);
+			return _mm_movemask_ps(changed) != 0;
+		}
+	};
+
+	// Mat3x4 rows are the columns of the Mat4, the constant last column of
+	// affine matrices is dropped by the transposition.
+	struct Mat3x4PaletteTraits
+	{
+		typedef Math::Mat3x4 Matrix;
+
+		static bool Store(const SimdFloat4 _rows[4], Matrix* _output)
+		{
+			SimdFloat4 r0 = _rows[0], r1 = _rows[1], r2 = _rows[2], r3 = _rows[3];
+			Math::simd::Transpose4x4(r0, r1, r2, r3);
+			float* m = _output->m;
+			const SimdFloat4 changed = _mm_or_ps(
+				_mm_or_ps(_mm_cmpneq_ps(r0, Math::simd::LoadPtrU(m + 0)),
+					_mm_cmpneq_ps(r1, Math::simd::LoadPtrU(m + 4))),
+				_mm_cmpneq_ps(r2, Math::simd::LoadPtrU(m + 8)));
+			Math::simd::StorePtrU(r0, m + 0);
+			Math::simd::StorePtrU(r1, m + 4);
+			Math::simd::StorePtrU(r2, m + 8);
+			return _mm_movemask_ps(changed) != 0;
+		}
+	};
+
+	// Converts 4 joints per iteration, the same way LocalToModelJob does. Each
+	// model-space matrix is then multiplied by the inverse bind poses of the
+	// meshes it skins, without being reloaded from memory.
+	template <typename _Traits>
+	void SkinningPalettes(const SkinningPaletteJob& _job, span<const span<typename _Traits::Matrix>> _palettes)
+	{
+		const std::vector<int16_t>& parents = _job.skeleton->joint_parents();
+		const int num_joints = _job.skeleton->num_joints();
+		const size_t num_meshes = _job.meshes.size();
+
+		const Math::Mat4& root_matrix = _job.root == nullptr ? Math::Mat4::IDENTITY : *_job.root;
+
+		// Next joint_remaps entry of each mesh. As joint_remaps are sorted, and
+		// joints are processed in order, they only move forward.
+		size_t cursors[SkinningPaletteJob::kMaxMeshes] = {};
+
+		for (int i = 0; i < num_joints;)
+		{
+			// Builds local matrices for the next 4 joints. Indices are clamped to
+			// the last joint so the input buffer is never overrun.
+			const Math::Transform* transforms[4];
+			for (int k = 0; k < 4; ++k)
+			{
+				transforms[k] = &_job.input[Math::Min(i + k, num_joints - 1)];
+			}
+			SimdFloat4 soa[12];
+			BuildSoaAffine(transforms, soa);
+			SimdFloat4 locals[4][4];
+			Mat4Traits::Locals(soa, locals);
+
+			for (int k = 0; k < 4 && i < num_joints; ++k, ++i)
+			{
+				const int parent = parents[i];
+				const Math::Mat4& parent_matrix =
+					parent == Skeleton::kNoParent ? root_matrix : _job.models[parent];
+				SimdFloat4 parent_rows[4];
+				Mat4Traits::Load(parent_matrix, parent_rows);
+				SimdFloat4 model_rows[4];
+				Mat4Traits::Multiply(locals[k], parent_rows, model_rows);
+				Mat4Traits::Store(model_rows, &_job.models[i]);
+
+				// Emits the palette entries of every mesh skinned by this joint.
+				const Math::Mat4* computed = nullptr;
+				SimdFloat4 palette_rows[4];
+				for (size_t m = 0; m < num_meshes; ++m)
+				{
+					const Mesh& mesh = _job.meshes[m];
+					for (size_t& c = cursors[m];
+						c < mesh.joint_remaps.size() && mesh.joint_remaps[c] == i; ++c)
+					{
+						const Math::Mat4& inverse_bind_pose = mesh.inverse_bind_poses[c];
+						if (computed == nullptr || !SameBindPose(inverse_bind_pose, *computed))
+						{
+							SimdFloat4 bind_rows[4];
+							Mat4Traits::Load(inverse_bind_pose, bind_rows);
+							Mat4Traits::Multiply(bind_rows, model_rows, palette_rows);
+							computed = &inverse_bind_pose;
+						}
+						const bool changed = _Traits::Store(palette_rows, &_palettes[m][c]);
+						SetChanged(_job, m, c, changed);
+					}
+				}
+			}
+		}
+	}
+#else  // MATH_SIMD_SSE2
+	// Scalar fallback, using full Mat4 multiplications.
+	struct Mat4PaletteTraits
+	{
+		typedef Math::Mat4 Matrix;
+		static bool Store(const Math::Mat4& _matrix, Matrix* _output)
+		{
+			const bool changed = std::memcmp(_output->m, _matrix.m, sizeof(_matrix.m)) != 0;
+			*_output = _matrix;
+			return changed;
+		}
+	};
+
+	struct Mat3x4PaletteTraits
+	{
+		typedef Math::Mat3x4 Matrix;
+		static bool Store(const Math::Mat4& _matrix, Matrix* _output)
+		{
+			const Matrix matrix(_matrix);
+			const bool changed = std::memcmp(_output->m, matrix.m, sizeof(matrix.m)) != 0;
+			*_output = matrix;
+			return changed;
+		}
+	};
+
+	template <typename _Traits>
+	void SkinningPalettes(const SkinningPaletteJob& _job, span<const span<typename _Traits::Matrix>> _palettes)
+	{
+		const std::vector<int16_t>& parents = _job.skeleton->joint_parents();
+		const int num_joints = _job.skeleton->num_joints();
+		const size_t num_meshes = _job.meshes.size();
+
+		const Math::Mat4& root_matrix = _job.root == nullptr ? Math::Mat4::IDENTITY : *_job.root;
+
+		size_t cursors[SkinningPaletteJob::kMaxMeshes] = {};
+
+		for (int i = 0; i < num_joints; ++i)
+		{
+			const Math::Transform& transform = _job.input[i];
+			const Math::Mat4 local = Math::MathUtil::Transformation(
+				transform.m_scale, transform.m_rotation, transform.m_translation);
+
+			const int parent = parents[i];
+			const Math::Mat4& parent_matrix =
+				parent == Skeleton::kNoParent ? root_matrix : _job.models[parent];
+			const Math::Mat4 model = local * parent_matrix;
+			_job.models[i] = model;
+
+			const Math::Mat4* computed = nullptr;
+			Math::Mat4 palette;
+			for (size_t m = 0; m < num_meshes; ++m)
+			{
+				const Mesh& mesh = _job.meshes[m];
+				for (size_t& c = cursors[m];
+					c < mesh.joint_remaps.size() && mesh.joint_remaps[c] == i; ++c)
+				{
+					const Math::Mat4& inverse_bind_pose = mesh.inverse_bind_poses[c];
+					if (computed == nullptr || !SameBindPose(inverse_bind_pose, *computed))
+					{
+						palette = inverse_bind_pose * model;
+						computed = &inverse_bind_pose;
+					}
+					const bool changed = _Traits::Store(palette, &_palettes[m][c]);
+					SetChanged(_job, m, c, changed);
+				}
+			}
+		}
+	}
+#endif  // MATH_SIMD_SSE2
+}  // namespace
+
+bool SkinningPaletteJob::Run() const
+{
+	if (!Validate()) {
+		return false;
+	}
+
+	if (!affine_palettes.empty())
+	{
+		SkinningPalettes<Mat3x4PaletteTraits>(*this, affine_palettes);
+	}
+	else
+	{
+		SkinningPalettes<Mat4PaletteTraits>(*this, palettes);
+	}
+
+	return true;
+}
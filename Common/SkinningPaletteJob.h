@@ -0,0 +1,93 @@
+#pragma once
+
+#include "span.h"
+
+// Forward declaration math structures.
+namespace Math
+{
+	class Transform;
+	class Mat4;
+	class Mat3x4;
+}
+
+// Forward declares the Skeleton and Mesh objects.
+class Skeleton;
+struct Mesh;
+
+// Computes the skinning matrices (aka palettes) of a set of meshes directly
+// from local-space transforms, fusing LocalToModelJob with the multiplication
+// of meshes inverse bind poses.
+// Joints are converted to model-space in order, and each model-space matrix is
+// immediately concatenated with the inverse bind poses of all the meshes it
+// skins (see Mesh::joint_remaps), while it's still in registers. When meshes
+// share a joint with the same inverse bind pose, which is the usual case for
+// meshes exported from a single skeleton, the skinning matrix is computed once
+// and copied to every palette.
+// Like LocalToModelJob, the whole hierarchy is updated. Inverse bind poses are
+// expected to be affine, and so is the root matrix when affine_palettes are
+// used.
+struct SkinningPaletteJob
+{
+	// Maximum number of meshes that a single job can process.
+	enum { kMaxMeshes = 32 };
+
+	// Default constructor, initializes default values.
+	SkinningPaletteJob();
+
+	// Validates job parameters. Returns true for a valid job, or false otherwise:
+	// -if skeleton is nullptr.
+	// -if the size of the input, or models, is smaller than the skeleton's
+	// number of joints.
+	// -if there are more than kMaxMeshes meshes.
+	// -if the number of palettes (or affine_palettes when they are used) doesn't
+	// match the number of meshes, or if any palette is smaller than its mesh
+	// joint_remaps.
+	// -if changed_joints are provided but their number doesn't match the number
+	// of meshes, or any is too small for its mesh joint_remaps.
+	// -if any mesh has less inverse bind poses than joint remaps, or is skinned
+	// by a joint that's out of the skeleton.
+	bool Validate() const;
+
+	// Runs job's skinning palette task.
+	// The job is validated before any operation is performed, see Validate() for
+	// more details.
+	// Returns false if job is not valid. See Validate() function.
+	bool Run() const;
+
+	// Job input.
+
+	// The Skeleton object describing the joint hierarchy used for local to
+	// model space conversion.
+	const Skeleton* skeleton;
+
+	// The root matrix will multiply to every model space matrices, default nullptr
+	// means an identity matrix.
+	const Math::Mat4* root;
+
+	// The input range that store local transforms.
+	span<const Math::Transform> input;
+
+	// The meshes to build palettes for. Their joint_remaps and
+	// inverse_bind_poses are used.
+	span<const Mesh> meshes;
+
+	// Job output.
+
+	// The output range to be filled with model-space matrices. Model-space
+	// matrices of parents are read back from it while traversing the hierarchy.
+	span<Math::Mat4> models;
+
+	// The skinning matrices of each mesh, one range per mesh, ordered like mesh
+	// joint_remaps: palettes[m][i] = inverse_bind_poses[i] * models[joint_remaps[i]].
+	span<const span<Math::Mat4>> palettes;
+
+	// Optional compact palettes, used instead of palettes if not empty.
+	span<const span<Math::Mat3x4>> affine_palettes;
+
+	// Optional bitsets, one per mesh, of the palette entries modified by this
+	// run: bit i of changed_joints[m][i / 32] is set if palettes[m][i] (or
+	// affine_palettes[m][i]) differs from the value it had before the run, and
+	// cleared otherwise. Palettes must then be persistent between runs. These
+	// are the SkinningJob::changed_joints used for incremental skinning.
+	span<const span<uint32_t>> changed_joints;
+};
@@ -0,0 +1,375 @@
+#include "StreamingAnimation.h"
+#include "../System/ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// File header, followed by the segments table, the name, then the keys of
+	// every segment.
+	struct Header
+	{
+		char tag[8];
+		uint32_t version;
+		// Keys are stored in their in-memory layout.
+		KeyLayout key_layout;
+		float duration;
+		int32_t num_tracks;
+		uint32_t name_len;
+		uint32_t num_segments;
+	};
+
+	const char kTag[8] = "jy-strm";
+	const uint32_t kVersion = 1;
+	const uint64_t kAlignment = 16;
+
+	// Extracts the keys required to sample _keys in ratio range [_begin,_end].
+	// _num_tracks is SoA padded, as padding tracks have keys too.
+	// Returns false if a track has less than 2 keys.
+	template <typename _Key>
+	bool SplitKeys(span<const _Key> _keys, int _num_tracks, float _begin, float _end, std::vector<_Key>* _out)
+	{
+		// Keys of every track in time order, and the position of every key in
+		// its track.
+		std::vector<std::vector<int>> tracks(_num_tracks);
+		std::vector<int> positions(_keys.size());
+		for (size_t k = 0; k < _keys.size(); ++k)
+		{
+			if (_keys[k].track >= _num_tracks)
+			{
+				return false;
+			}
+			std::vector<int>& track = tracks[_keys[k].track];
+			positions[k] = static_cast<int>(track.size());
+			track.push_back(static_cast<int>(k));
+		}
+
+		// Cursor snapshot, the last key at or before _begin and the next one,
+		// for every track. AnimationJob expects them as 2 rows in track order.
+		std::vector<int> first(_num_tracks);
+		_out->resize(_num_tracks * 2);
+		for (int t = 0; t < _num_tracks; ++t)
+		{
+			const std::vector<int>& track = tracks[t];
+			if (track.size() < 2)
+			{
+				return false;
+			}
+			int p = 0;
+			while (p + 2 < static_cast<int>(track.size()) && _keys[track[p + 1]].ratio <= _begin)
+			{
+				++p;
+			}
+			first[t] = p;
+			(*_out)[t] = _keys[track[p]];
+			(*_out)[_num_tracks + t] = _keys[track[p + 1]];
+		}
+
+		// Following keys, in the original order, as long as they are needed
+		// before _end, ie the previous key of their track is before _end.
+		for (size_t k = 0; k < _keys.size(); ++k)
+		{
+			const int t = _keys[k].track;
+			const int q = positions[k];
+			if (q > first[t] + 1 && _keys[tracks[t][q - 1]].ratio <= _end)
+			{
+				_out->push_back(_keys[k]);
+			}
+		}
+		return true;
+	}
+
+	// Writes _keys at *_offset, and moves *_offset past them.
+	template <typename _Key>
+	bool Write(const std::vector<_Key>& _keys, NativeFile& _file, uint64_t* _offset)
+	{
+		const uint64_t size = sizeof(_Key) * _keys.size();
+		const bool success = _keys.empty() || _file.WriteAt(_keys.data(), size, *_offset);
+		*_offset += size;
+		return success;
+	}
+}  // namespace
+
+bool StreamingAnimation::Build(const Animation& _animation, float _segment_duration, const std::string& _filename)
+{
+	if (!(_segment_duration > 0.f))
+	{
+		return false;
+	}
+
+	const int num_tracks = _animation.num_tracks();
+	const int num_padded_tracks = (num_tracks + 3) & ~3;
+	const int num_segments = Math::Max(1, static_cast<int>(std::ceil(_animation.Duration() / _segment_duration)));
+
+	// Splits keys of every segment.
+	struct Keys
+	{
+		std::vector<Float3Key> translations;
+		std::vector<QuaternionKey> rotations;
+		std::vector<Float3Key> scales;
+	};
+	std::vector<Keys> keys(num_segments);
+	std::vector<Segment> segments(num_segments);
+	for (int i = 0; i < num_segments; ++i)
+	{
+		Segment& segment = segments[i];
+		segment.begin = static_cast<float>(i) / num_segments;
+		segment.end = i == num_segments - 1 ? 1.f : static_cast<float>(i + 1) / num_segments;
+		if (!SplitKeys(_animation.translations(), num_padded_tracks, segment.begin, segment.end, &keys[i].translations) ||
+			!SplitKeys(_animation.rotations(), num_padded_tracks, segment.begin, segment.end, &keys[i].rotations) ||
+			!SplitKeys(_animation.scales(), num_padded_tracks, segment.begin, segment.end, &keys[i].scales))
+		{
+			return false;
+		}
+		segment.translation_count = static_cast<uint32_t>(keys[i].translations.size());
+		segment.rotation_count = static_cast<uint32_t>(keys[i].rotations.size());
+		segment.scale_count = static_cast<uint32_t>(keys[i].scales.size());
+		segment.padding = 0;
+	}
+
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.tag, kTag, sizeof(header.tag));
+	header.version = kVersion;
+	header.key_layout = KeyLayout::Native();
+	header.duration = _animation.Duration();
+	header.num_tracks = num_tracks;
+	header.name_len = static_cast<uint32_t>(strlen(_animation.name().c_str()));
+	header.num_segments = num_segments;
+
+	// Segments start aligned, their keys are contiguous.
+	uint64_t offset = sizeof(header) + sizeof(Segment) * segments.size() + header.name_len;
+	for (Segment& segment : segments)
+	{
+		segment.offset = Align(offset, kAlignment);
+		offset = segment.offset +
+			sizeof(Float3Key) * segment.translation_count +
+			sizeof(QuaternionKey) * segment.rotation_count +
+			sizeof(Float3Key) * segment.scale_count;
+	}
+
+	NativeFile file;
+	if (!file.Open(_filename.c_str(), NativeFile::OM_WRITE, NativeFile::AP_SEQUENTIAL))
+	{
+		return false;
+	}
+
+	bool success = file.WriteAt(&header, sizeof(header), 0);
+	success &= file.WriteAt(segments.data(), sizeof(Segment) * segments.size(), sizeof(header));
+	success &= header.name_len == 0 ||
+		file.WriteAt(_animation.name().data(), header.name_len, sizeof(header) + sizeof(Segment) * segments.size());
+
+	// Segments are written at their offset, padding in between is zero filled
+	// by the file system.
+	for (int i = 0; success && i < num_segments; ++i)
+	{
+		uint64_t position = segments[i].offset;
+		success &= Write(keys[i].translations, file, &position);
+		success &= Write(keys[i].rotations, file, &position);
+		success &= Write(keys[i].scales, file, &position);
+	}
+
+	return success;
+}
+
+StreamingAnimation::StreamingAnimation()
+	: duration_(0.f),
+	num_tracks_(0),
+	pool_(nullptr),
+	current_(-1)
+{
+	for (Slot& slot : slots_)
+	{
+		slot.segment = -1;
+		slot.state = kEmpty;
+	}
+}
+
+StreamingAnimation::~StreamingAnimation()
+{
+	Close();
+}
+
+bool StreamingAnimation::Open(const std::string& _filename, ThreadPool* _pool)
+{
+	Close();
+
+	// The file remains open, segments are read at random offsets.
+	if (!file_.Open(_filename.c_str(), NativeFile::OM_READ, NativeFile::AP_RANDOM))
+	{
+		return false;
+	}
+	const uint64_t size = file_.GetSize();
+
+	Header header;
+	bool valid = size >= sizeof(header) && file_.ReadAt(&header, sizeof(header), 0);
+	valid = valid && memcmp(header.tag, kTag, sizeof(header.tag)) == 0;
+	valid = valid && header.version == kVersion;
+	valid = valid && header.key_layout.IsNative();
+	valid = valid && header.num_segments > 0 && header.num_tracks >= 0;
+	valid = valid && sizeof(header) + sizeof(Segment) * static_cast<uint64_t>(header.num_segments) + header.name_len <= size;
+	if (valid)
+	{
+		segments_.resize(header.num_segments);
+		name_.resize(header.name_len);
+		valid &= file_.ReadAt(segments_.data(), sizeof(Segment) * segments_.size(), sizeof(header));
+		valid &= header.name_len == 0 ||
+			file_.ReadAt(&name_[0], header.name_len, sizeof(header) + sizeof(Segment) * segments_.size());
+	}
+
+	// Segments must be sorted in [0,1], start with the 2 keys of every SoA
+	// padded track, and have their keys within the file.
+	const uint64_t min_keys = 2 * ((static_cast<uint64_t>(header.num_tracks) + 3) & ~uint64_t(3));
+	for (size_t i = 0; valid && i < segments_.size(); ++i)
+	{
+		const Segment& segment = segments_[i];
+		valid &= segment.begin >= 0.f && segment.begin <= segment.end && segment.end <= 1.f;
+		valid &= i == 0 || (segment.begin > segments_[i - 1].begin && segment.end >= segments_[i - 1].end);
+		valid &= segment.translation_count >= min_keys &&
+			segment.rotation_count >= min_keys &&
+			segment.scale_count >= min_keys;
+		const uint64_t keys_size =
+			sizeof(Float3Key) * static_cast<uint64_t>(segment.translation_count) +
+			sizeof(QuaternionKey) * static_cast<uint64_t>(segment.rotation_count) +
+			sizeof(Float3Key) * static_cast<uint64_t>(segment.scale_count);
+		valid &= segment.offset <= size && keys_size <= size - segment.offset;
+	}
+
+	if (!valid)
+	{
+		Close();
+		return false;
+	}
+
+	duration_ = header.duration;
+	num_tracks_ = header.num_tracks;
+	pool_ = _pool;
+	return true;
+}
+
+void StreamingAnimation::Close()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	condition_.wait(lock, [this] { return slots_[0].state != kLoading && slots_[1].state != kLoading; });
+	for (Slot& slot : slots_)
+	{
+		slot.segment = -1;
+		slot.state = kEmpty;
+		slot.animation = Animation();
+	}
+	current_ = -1;
+	file_.Close();
+	duration_ = 0.f;
+	num_tracks_ = 0;
+	name_.clear();
+	segments_.clear();
+	pool_ = nullptr;
+}
+
+int StreamingAnimation::GetSegment(float _ratio) const
+{
+	// Uses stored bounds rather than recomputing them, so that the segment
+	// always contains _ratio.
+	const auto it = std::upper_bound(segments_.begin(), segments_.end(), _ratio, [](float _value, const Segment& _segment)
+		{
+			return _value < _segment.begin;
+		});
+	return Math::Max(0, static_cast<int>(it - segments_.begin()) - 1);
+}
+
+bool StreamingAnimation::LoadSegment(int _segment, Animation* _animation) const
+{
+	const Segment& segment = segments_[_segment];
+
+	// Positional reads don't share a file pointer, so segments can be loaded
+	// concurrently.
+	_animation->Allocate(segment.translation_count, segment.rotation_count, segment.scale_count);
+	const uint64_t translations_size = sizeof(Float3Key) * _animation->translations_.size();
+	const uint64_t rotations_size = sizeof(QuaternionKey) * _animation->rotations_.size();
+	const uint64_t scales_size = sizeof(Float3Key) * _animation->scales_.size();
+	bool success = translations_size == 0 ||
+		file_.ReadAt(_animation->translations_.data(), translations_size, segment.offset);
+	success = success && (rotations_size == 0 ||
+		file_.ReadAt(_animation->rotations_.data(), rotations_size, segment.offset + translations_size));
+	success = success && (scales_size == 0 ||
+		file_.ReadAt(_animation->scales_.data(), scales_size, segment.offset + translations_size + rotations_size));
+
+	_animation->duration_ = duration_;
+	_animation->num_tracks_ = num_tracks_;
+	_animation->name_ = name_;
+	return success;
+}
+
+void StreamingAnimation::Load(int _slot, int _segment, bool _async, std::unique_lock<std::mutex>& _lock)
+{
+	Slot& slot = slots_[_slot];
+	slot.segment = _segment;
+	slot.state = kLoading;
+
+	if (_async)
+	{
+		pool_->Enqueue([this, _slot, _segment]()
+			{
+				Slot& slot = slots_[_slot];
+				const bool success = LoadSegment(_segment, &slot.animation);
+				// Notifies under the lock, as Close() may destroy the condition
+				// as soon as the state isn't loading anymore.
+				std::lock_guard<std::mutex> lock(mutex_);
+				slot.state = success ? kReady : kFailed;
+				condition_.notify_all();
+			});
+	}
+	else
+	{
+		// Unlocks so that a prefetch of the other slot can complete meanwhile.
+		_lock.unlock();
+		const bool success = LoadSegment(_segment, &slot.animation);
+		_lock.lock();
+		slot.state = success ? kReady : kFailed;
+	}
+}
+
+const Animation* StreamingAnimation::Update(float _ratio)
+{
+	if (segments_.empty())
+	{
+		return nullptr;
+	}
+
+	const int segment = GetSegment(_ratio);
+	std::unique_lock<std::mutex> lock(mutex_);
+
+	// Uses the resident (or prefetching) segment. Otherwise it's loaded to the
+	// slot that wasn't returned last, so the animation address changes and the
+	// sampling context is reset.
+	int index = -1;
+	for (int i = 0; i < 2; ++i)
+	{
+		if (slots_[i].segment == segment && slots_[i].state != kFailed)
+		{
+			index = i;
+		}
+	}
+	if (index < 0)
+	{
+		index = current_ < 0 ? 0 : 1 - current_;
+		condition_.wait(lock, [this, index] { return slots_[index].state != kLoading; });
+		Load(index, segment, false, lock);
+	}
+	condition_.wait(lock, [this, index] { return slots_[index].state != kLoading; });
+	current_ = index;
+	const Animation* animation = slots_[index].state == kReady ? &slots_[index].animation : nullptr;
+
+	// Prefetches the following segment, wrapping around for looping playback.
+	const int next = (segment + 1) % num_segments();
+	Slot& other = slots_[1 - index];
+	if (pool_ && next != segment && other.segment != next)
+	{
+		condition_.wait(lock, [&other] { return other.state != kLoading; });
+		Load(1 - index, next, true, lock);
+	}
+
+	return animation;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Animation.h"
+#include "../System/NativeFile.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// A long animation clip split into time segments, of which only the one being
+// sampled and the next one are resident.
+// Every segment is a standalone Animation that AnimationJob can sample at any
+// ratio of the segment. Its keys start with a snapshot of the cursor at the
+// beginning of the segment, ie the 2 keys framing the segment's first ratio
+// for every track, followed by the keys of the original animation that are
+// required until the segment's last ratio, in the same order. Sampling a
+// segment hence gives the same result as sampling the whole animation.
+// Segments are loaded from disk by Update(), and the next segment is
+// prefetched on a ThreadPool, so that playing forward doesn't wait for loads.
+// A StreamingAnimation must only be sampled by a single AnimationJob::Context,
+// which is reset by the job every time the segment changes as segments are
+// loaded to different Animation objects.
+class StreamingAnimation
+{
+public:
+	// Splits _animation in segments of _segment_duration seconds, and writes
+	// them to _filename.
+	static bool Build(const Animation& _animation, float _segment_duration, const std::string& _filename);
+
+	StreamingAnimation();
+	~StreamingAnimation();
+
+	StreamingAnimation(StreamingAnimation const&) = delete;
+	StreamingAnimation& operator=(StreamingAnimation const&) = delete;
+
+	// Opens a file written by Build, reading only its segments table. Segments
+	// are prefetched on _pool, or only loaded when needed if it's nullptr.
+	bool Open(const std::string& _filename, ThreadPool* _pool = nullptr);
+
+	// Waits for pending prefetches and releases all segments.
+	void Close();
+
+	float Duration() const { return duration_; }
+	int num_tracks() const { return num_tracks_; }
+	const std::string& name() const { return name_; }
+	int num_segments() const { return static_cast<int>(segments_.size()); }
+
+	// Gets the index of the segment that contains _ratio.
+	int GetSegment(float _ratio) const;
+
+	// Gets the animation to sample at _ratio, loading its segment if it isn't
+	// resident yet, and prefetches the next segment. Returns nullptr if the
+	// segment can't be loaded. The animation remains valid until the next call.
+	const Animation* Update(float _ratio);
+
+private:
+	// Segment table entry, as stored in the file.
+	struct Segment
+	{
+		float begin;
+		float end;
+		uint32_t translation_count;
+		uint32_t rotation_count;
+		uint32_t scale_count;
+		uint32_t padding;
+		uint64_t offset;
+	};
+
+	enum State
+	{
+		kEmpty,
+		kLoading,
+		kReady,
+		kFailed,
+	};
+
+	// A resident segment.
+	struct Slot
+	{
+		int segment;
+		State state;
+		Animation animation;
+	};
+
+	// Loads _segment to _animation, can be called from any thread.
+	bool LoadSegment(int _segment, Animation* _animation) const;
+
+	// Loads _segment to slot _slot, synchronously or on pool_. Slot must not
+	// be loading.
+	void Load(int _slot, int _segment, bool _async, std::unique_lock<std::mutex>& _lock);
+
+	NativeFile file_;
+	float duration_;
+	int num_tracks_;
+	std::string name_;
+	std::vector<Segment> segments_;
+
+	ThreadPool* pool_;
+
+	// Resident segments, and the one returned by the last Update. Slots state
+	// is protected by mutex_.
+	Slot slots_[2];
+	int current_;
+	std::mutex mutex_;
+	std::condition_variable condition_;
+};
@@ -1,6 +1,10 @@
 #include "Utils.h"
 #include "Skeleton.h"
 #include "LocalToModelJob.h"
+#include "Mesh.h"
+
+#include <cfloat>
+#include <cmath>
 
 void ComputeSkeletonBounds(const Skeleton& _skeleton, Math::AABB* _bound) 
 {
@@ -62,4 +66,86 @@ void ComputePostureBounds(span<const Math::Mat4> _matrices, Math::AABB* _bound)
 	_bound->_min = min;
 
 	return;
-}
\ No newline at end of file
+}
+
+bool ComputeJointBounds(const Mesh& _mesh, span<Math::AABB> _bounds)
+{
+	const int num_joints = _mesh.num_joints();
+	if (_bounds.size() < static_cast<size_t>(num_joints))
+	{
+		return false;
+	}
+
+	// Starts from empty boxes, so that the first merged point sets them.
+	const Math::AABB empty(Math::Vec3(FLT_MAX), Math::Vec3(-FLT_MAX));
+	for (int i = 0; i < num_joints; ++i)
+	{
+		_bounds[i] = empty;
+	}
+
+	for (const Mesh::Part& part : _mesh.parts)
+	{
+		const int vertex_count = part.vertex_count();
+		const int influences_count = part.influences_count();
+		for (int v = 0; v < vertex_count; ++v)
+		{
+			const float* p = &part.positions[v * Mesh::Part::kPositionsCpnts];
+			const Math::Vec3 position(p[0], p[1], p[2]);
+			for (int j = 0; j < influences_count; ++j)
+			{
+				const uint16_t joint = part.joint_indices[v * influences_count + j];
+				if (joint >= num_joints)
+				{
+					return false;
+				}
+				_bounds[joint].Merge(position);
+			}
+		}
+	}
+
+	return true;
+}
+
+void ComputeSkinnedBounds(span<const Math::Mat4> _skinning_matrices,
+	span<const Math::AABB> _joint_bounds, Math::AABB* _bound)
+{
+	assert(_bound);
+
+	// Set a default box.
+	*_bound = Math::AABB();
+
+	const size_t num_joints = Math::Min(_skinning_matrices.size(), _joint_bounds.size());
+	bool first = true;
+	for (size_t i = 0; i < num_joints; ++i)
+	{
+		const Math::AABB& box = _joint_bounds[i];
+		if (box.IsEmpty())
+		{
+			continue;
+		}
+
+		// Transforms the box center, and projects its extent on the matrix rows.
+		const Math::Mat4& m = _skinning_matrices[i];
+		const Math::Vec3 c = box.GetCenter();
+		const Math::Vec3 e = box.GetExtent();
+		const Math::Vec3 center(
+			c.x * m.a11 + c.y * m.a21 + c.z * m.a31 + m.a41,
+			c.x * m.a12 + c.y * m.a22 + c.z * m.a32 + m.a42,
+			c.x * m.a13 + c.y * m.a23 + c.z * m.a33 + m.a43);
+		const Math::Vec3 extent(
+			e.x * std::fabs(m.a11) + e.y * std::fabs(m.a21) + e.z * std::fabs(m.a31),
+			e.x * std::fabs(m.a12) + e.y * std::fabs(m.a22) + e.z * std::fabs(m.a32),
+			e.x * std::fabs(m.a13) + e.y * std::fabs(m.a23) + e.z * std::fabs(m.a33));
+		const Math::AABB transformed(center - extent, center + extent);
+
+		if (first)
+		{
+			*_bound = transformed;
+			first = false;
+		}
+		else
+		{
+			_bound->Merge(transformed);
+		}
+	}
+}
@@ -4,6 +4,7 @@
 #include "span.h"
 
 class Skeleton;
+struct Mesh;
 
 // Computes the bounding box of _skeleton. This is the box that encloses all
 // skeleton's joints in model space.
@@ -12,4 +13,22 @@ void ComputeSkeletonBounds(const Skeleton& _skeleton, Math::AABB* _bound);
 
 // Computes the bounding box of posture defines be _matrices range.
 // _bound must be a valid Math::AABB instance.
-void ComputePostureBounds(span<const Math::Mat4> _matrices, Math::AABB* _bound);
\ No newline at end of file
+void ComputePostureBounds(span<const Math::Mat4> _matrices, Math::AABB* _bound);
+
+// Computes the bind-space bounding box of the vertices influenced by each
+// joint of _mesh, ordered like the mesh skinning matrices (see
+// Mesh::joint_remaps). Meant to be computed once, at load time, for
+// ComputeSkinnedBounds. Boxes of joints that don't influence any vertex are
+// left empty (see Math::AABB::IsEmpty).
+// Returns false if _bounds is smaller than _mesh.num_joints(), or if a joint
+// index is out of range.
+bool ComputeJointBounds(const Mesh& _mesh, span<Math::AABB> _bounds);
+
+// Computes the bounding box of a skinned mesh, as the union of the joint
+// bounds (see ComputeJointBounds) transformed by their skinning matrix. As a
+// skinned vertex is a weighted average of its position transformed by every
+// influencing joint, it's always inside this box. The cost depends on the
+// number of joints rather than on the number of vertices.
+// _bound must be a valid Math::AABB instance.
+void ComputeSkinnedBounds(span<const Math::Mat4> _skinning_matrices,
+	span<const Math::AABB> _joint_bounds, Math::AABB* _bound);
@@ -878,6 +878,33 @@ bool Renderer::DrawSkinnedMesh(
 			}
 		}
 
+		// Uses quantized inputs instead if the mesh provides them. Outputs are
+		// the same.
+		if (_mesh.quantized_parts.size() == _mesh.parts.size())
+		{
+			const Mesh::QuantizedPart& quantized = _mesh.quantized_parts[i];
+			skinning_job.in_quantized_positions = make_span(quantized.positions);
+			skinning_job.in_quantized_positions_stride = sizeof(uint16_t) * 3;
+			skinning_job.positions_offset = quantized.positions_offset;
+			skinning_job.positions_scale = quantized.positions_scale;
+			if (!skinning_job.out_normals.empty())
+			{
+				skinning_job.in_quantized_normals = make_span(quantized.normals);
+				skinning_job.in_quantized_normals_stride = sizeof(int16_t) * 2;
+			}
+			if (!skinning_job.out_tangents.empty())
+			{
+				skinning_job.in_quantized_tangents = make_span(quantized.tangents);
+				skinning_job.in_quantized_tangents_stride = sizeof(int16_t) * 2;
+			}
+			if (part_influences_count > 1)
+			{
+				skinning_job.quantized_joint_weights = make_span(quantized.joint_weights);
+				skinning_job.quantized_joint_weights_stride =
+					sizeof(uint8_t) * (part_influences_count - 1);
+			}
+		}
+
 		// Execute the job, which should succeed unless a parameter is invalid.
 		if (!skinning_job.Run()) {
 			return false;
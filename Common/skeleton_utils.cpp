@@ -5,15 +5,7 @@
 
 int FindJoint(const Skeleton& _skeleton, const char* _name)
 {
-	const auto& names = _skeleton.joint_names();
-	for (size_t i = 0; i < names.size(); ++i)
-	{
-		if (std::strcmp(names[i].c_str(), _name) == 0)
-		{
-			return static_cast<int>(i);
-		}
-	}
-	return -1;
+	return _skeleton.FindJoint(_name);
 }
 
 // Unpacks skeleton rest pose stored in soa format by the skeleton.
@@ -4,12 +4,14 @@
 #include "Box2d.h"
 #include "Color.h"
 #include "CubicBezier.h"
+#include "DualQuaternion.h"
 #include "Frustum.h"
 #include "IntRect.h"
 #include "IntVec2.h"
 #include "IntVec3.h"
 #include "IntVec4.h"
 #include "Mat3.h"
+#include "Mat3x4.h"
 #include "Mat4.h"
 #include "Math.h"
 #include "MathUtil.h"
@@ -0,0 +1,62 @@
+#include "DualQuaternion.h"
+
+NS_JYE_MATH_BEGIN
+
+const DualQuaternion DualQuaternion::IDENTITY = DualQuaternion();
+
+DualQuaternion::DualQuaternion(const Quaternion& _rotation, const Vec3& _translation)
+	: m_real(_rotation)
+{
+	// dual = 0.5 * (translation, 0) * rotation, Hamilton product.
+	const Vec3 v(_rotation.x, _rotation.y, _rotation.z);
+	const Vec3 d = (_translation * _rotation.w + CrossProduct(_translation, v)) * 0.5f;
+	m_dual.set(d.x, d.y, d.z, -0.5f * Dot(_translation, v));
+}
+
+DualQuaternion::DualQuaternion(const Mat4& _mat)
+{
+	// Rows are the images of the axes, normalizing them removes scale.
+	Vec3 r0(_mat.a11, _mat.a12, _mat.a13);
+	Vec3 r1(_mat.a21, _mat.a22, _mat.a23);
+	Vec3 r2(_mat.a31, _mat.a32, _mat.a33);
+	r0.Normalize();
+	r1.Normalize();
+	r2.Normalize();
+
+	// Extracts the quaternion from the largest diagonal term, for precision.
+	Quaternion q;
+	const float trace = r0.x + r1.y + r2.z;
+	if (trace > 0.0f)
+	{
+		const float s = 0.5f / sqrtf(trace + 1.0f);
+		q.set((r1.z - r2.y) * s, (r2.x - r0.z) * s, (r0.y - r1.x) * s, 0.25f / s);
+	}
+	else if (r0.x > r1.y && r0.x > r2.z)
+	{
+		const float s = 2.0f * sqrtf(1.0f + r0.x - r1.y - r2.z);
+		q.set(0.25f * s, (r1.x + r0.y) / s, (r2.x + r0.z) / s, (r1.z - r2.y) / s);
+	}
+	else if (r1.y > r2.z)
+	{
+		const float s = 2.0f * sqrtf(1.0f + r1.y - r0.x - r2.z);
+		q.set((r1.x + r0.y) / s, 0.25f * s, (r2.y + r1.z) / s, (r2.x - r0.z) / s);
+	}
+	else
+	{
+		const float s = 2.0f * sqrtf(1.0f + r2.z - r0.x - r1.y);
+		q.set((r2.x + r0.z) / s, (r2.y + r1.z) / s, 0.25f * s, (r0.y - r1.x) / s);
+	}
+	q.Normalize();
+
+	*this = DualQuaternion(q, Vec3(_mat.a41, _mat.a42, _mat.a43));
+}
+
+Vec3 DualQuaternion::GetTranslation() const
+{
+	// translation = 2 * dual * conjugate(real), Hamilton product.
+	const Vec3 r(m_real.x, m_real.y, m_real.z);
+	const Vec3 d(m_dual.x, m_dual.y, m_dual.z);
+	return (d * m_real.w - r * m_dual.w + CrossProduct(r, d)) * 2.0f;
+}
+
+NS_JYE_MATH_END
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Vec3.h"
+#include "Quaternion.h"
+#include "Mat4.h"
+
+NS_JYE_MATH_BEGIN
+
+// Unit dual quaternion, representing a rigid transformation (rotation followed
+// by a translation) with 8 floats.
+// Unlike matrices, dual quaternions can be linearly blended and renormalized
+// without collapsing volumes around twisting joints, which is what skinning
+// relies on. They can't represent scale nor shear.
+class MATH_API DualQuaternion
+{
+public:
+	// Rotation part.
+	Quaternion m_real;
+	// Translation part, 0.5 * translation * m_real.
+	Quaternion m_dual;
+
+	DualQuaternion() : m_real(Quaternion::IDENTITY) { m_dual.set(0.0f, 0.0f, 0.0f, 0.0f); }
+	DualQuaternion(const Quaternion& _rotation, const Vec3& _translation);
+
+	// Builds from the rigid part of a Mat4 (row vector convention). Scale is
+	// removed from the rotation rows, shear and projection are ignored.
+	explicit DualQuaternion(const Mat4& _mat);
+
+	// Returns the translation part.
+	Vec3 GetTranslation() const;
+
+	// Transforms a point, translation is applied. Expects a unit dual quaternion.
+	Vec3 TransformPoint(const Vec3& _p) const { return m_real * _p + GetTranslation(); }
+
+	// Transforms a vector, translation is ignored.
+	Vec3 TransformVector(const Vec3& _v) const { return m_real * _v; }
+
+	const float* GetPtr() const { return &m_real.x; }
+
+	static const DualQuaternion IDENTITY;
+};
+
+NS_JYE_MATH_END
@@ -0,0 +1,57 @@
+#include "Mat3x4.h"
+
+NS_JYE_MATH_BEGIN
+
+const Mat3x4 Mat3x4::IDENTITY = Mat3x4(
+	1.0f, 0.0f, 0.0f, 0.0f,
+	0.0f, 1.0f, 0.0f, 0.0f,
+	0.0f, 0.0f, 1.0f, 0.0f);
+
+Mat3x4::Mat3x4()
+{
+	*this = IDENTITY;
+}
+
+Mat3x4::Mat3x4(float m11, float m12, float m13, float m14, float m21, float m22, float m23, float m24,
+	float m31, float m32, float m33, float m34)
+{
+	a11 = m11;
+	a12 = m12;
+	a13 = m13;
+	a14 = m14;
+	a21 = m21;
+	a22 = m22;
+	a23 = m23;
+	a24 = m24;
+	a31 = m31;
+	a32 = m32;
+	a33 = m33;
+	a34 = m34;
+}
+
+Mat3x4::Mat3x4(const Mat4& _mat)
+{
+	a11 = _mat.a11;
+	a12 = _mat.a21;
+	a13 = _mat.a31;
+	a14 = _mat.a41;
+	a21 = _mat.a12;
+	a22 = _mat.a22;
+	a23 = _mat.a32;
+	a24 = _mat.a42;
+	a31 = _mat.a13;
+	a32 = _mat.a23;
+	a33 = _mat.a33;
+	a34 = _mat.a43;
+}
+
+Mat4 Mat3x4::ToMat4() const
+{
+	return Mat4(
+		a11, a21, a31, 0.0f,
+		a12, a22, a32, 0.0f,
+		a13, a23, a33, 0.0f,
+		a14, a24, a34, 1.0f);
+}
+
+NS_JYE_MATH_END
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Vec3.h"
+#include "Mat4.h"
+
+NS_JYE_MATH_BEGIN
+
+// Compact affine matrix.
+// Mat4 is used with the row vector convention (v * m), so an affine Mat4 always
+// has (0, 0, 0, 1) as its last column. Mat3x4 drops that constant column and
+// stores the 3 others transposed: row i of a Mat3x4 is column i of the Mat4.
+// Each row is then 16 bytes, which is what SIMD code and GPU skinning palettes
+// want, and transforming a point is 3 dot products with (x, y, z, 1).
+class MATH_API Mat3x4
+{
+public:
+	union
+	{
+		struct
+		{
+			float a11, a12, a13, a14;
+			float a21, a22, a23, a24;
+			float a31, a32, a33, a34;
+		};
+		float m[12];
+	};
+
+	Mat3x4();
+	Mat3x4(float m11, float m12, float m13, float m14, float m21, float m22, float m23, float m24,
+		float m31, float m32, float m33, float m34);
+
+	// Builds from an affine Mat4. The last column of _mat is ignored.
+	explicit Mat3x4(const Mat4& _mat);
+
+	// Expands back to a Mat4, restoring the constant (0, 0, 0, 1) column.
+	Mat4 ToMat4() const;
+
+	// Transforms a point, translation is applied.
+	Vec3 TransformPoint(const Vec3& _p) const
+	{
+		return Vec3(a11 * _p.x + a12 * _p.y + a13 * _p.z + a14,
+			a21 * _p.x + a22 * _p.y + a23 * _p.z + a24,
+			a31 * _p.x + a32 * _p.y + a33 * _p.z + a34);
+	}
+
+	// Transforms a vector, translation is ignored.
+	Vec3 TransformVector(const Vec3& _v) const
+	{
+		return Vec3(a11 * _v.x + a12 * _v.y + a13 * _v.z,
+			a21 * _v.x + a22 * _v.y + a23 * _v.z,
+			a31 * _v.x + a32 * _v.y + a33 * _v.z);
+	}
+
+	const float* GetPtr() const { return &a11; }
+
+	static const Mat3x4 IDENTITY;
+};
+
+NS_JYE_MATH_END
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Math.h"
+
+// Enables SSE2 code paths when the target supports them. x64 always does, so
+// this is only disabled on exotic 32 bits or non-x86 targets, which fall back
+// to scalar implementations.
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH_SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define MATH_SIMD_SSE2 0
+#endif
+
+#if MATH_SIMD_SSE2
+
+NS_JYE_MATH_BEGIN
+
+// A vector of 4 floats, stored in a SSE register.
+typedef __m128 SimdFloat4;
+
+// A vector of 4 integers, stored in a SSE register.
+typedef __m128i SimdInt4;
+
+namespace simd
+{
+	// Loads 4 floats from an unaligned address.
+	static FORCEINLINE SimdFloat4 LoadPtrU(const float* _f) { return _mm_loadu_ps(_f); }
+
+	// Stores 4 floats to an unaligned address.
+	static FORCEINLINE void StorePtrU(SimdFloat4 _v, float* _f) { _mm_storeu_ps(_f, _v); }
+
+	// Loads x, y, z from an unaligned address, w is set to 0.
+	static FORCEINLINE SimdFloat4 Load3PtrU(const float* _f)
+	{
+		return _mm_movelh_ps(
+			_mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(_f))),
+			_mm_load_ss(_f + 2));
+	}
+
+	// Stores x, y, z to an unaligned address, w is left untouched.
+	static FORCEINLINE void Store3PtrU(SimdFloat4 _v, float* _f)
+	{
+		_mm_storel_pi(reinterpret_cast<__m64*>(_f), _v);
+		_mm_store_ss(_f + 2, _mm_movehl_ps(_v, _v));
+	}
+
+	static FORCEINLINE SimdFloat4 Load1(float _f) { return _mm_set1_ps(_f); }
+
+	static FORCEINLINE SimdFloat4 Zero() { return _mm_setzero_ps(); }
+
+	static FORCEINLINE SimdFloat4 One() { return _mm_set1_ps(1.f); }
+
+	// Returns (0, 0, 0, 1).
+	static FORCEINLINE SimdFloat4 W_Axis() { return _mm_set_ps(1.f, 0.f, 0.f, 0.f); }
+
+	// Replicates component _i to all 4 components.
+	template <int _i>
+	static FORCEINLINE SimdFloat4 Splat(SimdFloat4 _v)
+	{
+		return _mm_shuffle_ps(_v, _v, _MM_SHUFFLE(_i, _i, _i, _i));
+	}
+
+	// Returns _a * _b + _c.
+	static FORCEINLINE SimdFloat4 MAdd(SimdFloat4 _a, SimdFloat4 _b, SimdFloat4 _c)
+	{
+		return _mm_add_ps(_mm_mul_ps(_a, _b), _c);
+	}
+
+	// Returns (0, 0, 0, _v.w), used to carry the translation lane of affine
+	// matrices without a multiplication.
+	static FORCEINLINE SimdFloat4 KeepW(SimdFloat4 _v)
+	{
+		return _mm_and_ps(_v, _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0)));
+	}
+
+	// Returns the dot product of _a and _b, replicated to all 4 components.
+	static FORCEINLINE SimdFloat4 Dot4(SimdFloat4 _a, SimdFloat4 _b)
+	{
+		const SimdFloat4 m = _mm_mul_ps(_a, _b);
+		const SimdFloat4 s = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_add_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 0, 3, 2)));
+	}
+
+	// Returns the cross product of the x, y, z components of _a and _b, w is 0.
+	static FORCEINLINE SimdFloat4 Cross3(SimdFloat4 _a, SimdFloat4 _b)
+	{
+		const SimdFloat4 a_yzx = _mm_shuffle_ps(_a, _a, _MM_SHUFFLE(3, 0, 2, 1));
+		const SimdFloat4 b_yzx = _mm_shuffle_ps(_b, _b, _MM_SHUFFLE(3, 0, 2, 1));
+		const SimdFloat4 c = _mm_sub_ps(_mm_mul_ps(_a, b_yzx), _mm_mul_ps(a_yzx, _b));
+		return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+	}
+
+	// Transposes the 4x4 matrix made of the 4 input registers, in place.
+	static FORCEINLINE void Transpose4x4(SimdFloat4& _r0, SimdFloat4& _r1, SimdFloat4& _r2, SimdFloat4& _r3)
+	{
+		_MM_TRANSPOSE4_PS(_r0, _r1, _r2, _r3);
+	}
+}  // namespace simd
+
+NS_JYE_MATH_END
+
+#endif  // MATH_SIMD_SSE2
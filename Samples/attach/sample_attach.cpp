@@ -104,7 +104,9 @@ protected:
 		context_.Resize(num_joints);
 
 		// Finds the joint where the object should be attached.
-		attachment_ = FindJoint(skeleton_, "Bip01 L Finger01");
+		// Joint name is hashed at compile time.
+		static constexpr JointName kAttachmentJoint("Bip01 L Finger01");
+		attachment_ = skeleton_.FindJoint(kAttachmentJoint);
 		if (attachment_ < 0) 
 		{
 			return false;
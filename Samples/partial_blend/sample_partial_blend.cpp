@@ -231,7 +231,7 @@ protected:
 			ImGui::Text("Root of the upper body hierarchy:");
 
 			static float coeff = 1.f;  // All power to the partial animation.
-			if (ImGui::SliderInt(skeleton_.joint_names()[upper_body_root_].c_str(), &upper_body_root_, 0, skeleton_.num_joints() - 1))
+			if (ImGui::SliderInt(skeleton_.joint_name(upper_body_root_), &upper_body_root_, 0, skeleton_.num_joints() - 1))
 			{
 				SetupPerJointWeights();
 			}
@@ -2,7 +2,7 @@
 #include "../Common/framework/application.h"
 #include "../Common/framework/renderer.h"
 #include "../Common/RawAnimation.h"
-#include "../Common/LocalToModelJob.h"
+#include "../Common/SkinningPaletteJob.h"
 #include "../Common/AnimationJob.h"
 #include "../Common/RawAnimationJob.h"
 #include "../Common/Skeleton.h"
@@ -11,6 +11,7 @@
 #include "../Common/Utils.h"
 #include "../Common/imgui/imgui.h"
 #include "../Common/Mesh.h"
+#include "../Common/MeshOptimizeJob.h"
 
 class SkinningSampleApplication : public Application {
 public:
@@ -38,12 +39,18 @@ protected:
 			return false;
 		}
 
-		// Converts from local space to model space matrices.
-		LocalToModelJob ltm_job;
-		ltm_job.skeleton = &skeleton_;
-		ltm_job.input = make_span(locals_);
-		ltm_job.output = make_span(models_);
-		if (!ltm_job.Run()) {
+		// Converts from local space to model space matrices, and builds skinning
+		// matrices of all meshes in the same pass. The meshes might not use (aka
+		// be skinned by) all skeleton joints. The joint remapping table
+		// (available from the mesh object) is used to reorder model-space
+		// matrices and build skinning ones.
+		SkinningPaletteJob palette_job;
+		palette_job.skeleton = &skeleton_;
+		palette_job.input = make_span(locals_);
+		palette_job.meshes = make_span(meshes_);
+		palette_job.models = make_span(models_);
+		palette_job.palettes = make_span(palettes_);
+		if (!palette_job.Run()) {
 			return false;
 		}
 
@@ -63,20 +70,11 @@ protected:
 
 		if (draw_mesh_)
 		{
-			// Builds skinning matrices, based on the output of the animation stage.
-			// The mesh might not use (aka be skinned by) all skeleton joints. We
-			// use the joint remapping table (available from the mesh object) to
-			// reorder model-space matrices and build skinning ones.
-			for (const Mesh& mesh : meshes_)
+			// Renders skins, using skinning matrices built during update.
+			for (size_t i = 0; i < meshes_.size(); ++i)
 			{
-				for (size_t i = 0; i < mesh.joint_remaps.size(); ++i)
-				{
-					skinning_matrices_[i] = mesh.inverse_bind_poses[i] * models_[mesh.joint_remaps[i]];
-				}
-
-				// Renders skin.
 				success &= _renderer->DrawSkinnedMesh(
-					mesh, make_span(skinning_matrices_), transform, render_options_);
+					meshes_[i], palettes_[i], transform, render_options_);
 			}
 		}
 		return success;
@@ -105,6 +103,18 @@ protected:
 			return false;
 		}
 
+		// Re-partitions meshes so that skinning reads palettes linearly.
+		for (Mesh& mesh : meshes_)
+		{
+			MeshOptimizeJob optimize_job;
+			optimize_job.input = &mesh;
+			optimize_job.output = &mesh;
+			if (!optimize_job.Run())
+			{
+				return false;
+			}
+		}
+
 		// Skeleton and animation needs to match.
 		if (skeleton_.num_joints() != animation_.num_tracks())
 		{
@@ -119,20 +129,19 @@ protected:
 		// Allocates a context that matches animation requirements.
 		context_.Resize(num_joints);
 
-		// Computes the number of skinning matrices required to skin all meshes.
+		// Allocates skinning matrices of each mesh.
 		// A mesh is skinned by only a subset of joints, so the number of skinning
 		// matrices might be less that the number of skeleton joints.
 		// Mesh::joint_remaps is used to know how to order skinning matrices. So
 		// the number of matrices required is the size of joint_remaps.
-		size_t num_skinning_matrices = 0;
-		for (const Mesh& mesh : meshes_)
+		skinning_matrices_.resize(meshes_.size());
+		palettes_.resize(meshes_.size());
+		for (size_t i = 0; i < meshes_.size(); ++i)
 		{
-			num_skinning_matrices = Math::Max(num_skinning_matrices, mesh.joint_remaps.size());
+			skinning_matrices_[i].resize(meshes_[i].joint_remaps.size());
+			palettes_[i] = make_span(skinning_matrices_[i]);
 		}
 
-		// Allocates skinning matrices.
-		skinning_matrices_.resize(num_skinning_matrices);
-
 		// Check the skeleton matches with the mesh, especially that the mesh
 		// doesn't expect more joints than the skeleton has.
 		for (const Mesh& mesh : meshes_)
@@ -212,9 +221,12 @@ private:
 	// Buffer of model space matrices.
 	std::vector<Math::Mat4> models_;
 
-	// Buffer of skinning matrices, result of the joint multiplication of the
-	// inverse bind pose with the model space matrix.
-	std::vector<Math::Mat4> skinning_matrices_;
+	// Buffers of skinning matrices of each mesh, result of the joint
+	// multiplication of the inverse bind pose with the model space matrix.
+	std::vector<std::vector<Math::Mat4>> skinning_matrices_;
+
+	// Ranges of skinning_matrices_, as expected by SkinningPaletteJob.
+	std::vector<span<Math::Mat4>> palettes_;
 
 	// The mesh used by the sample.
 	std::vector<Mesh> meshes_;
@@ -1,7 +1,7 @@
 
 #pragma once
 
-#include "platform/PlatformConfig.h"
+#include "Platform/PlatformConfig.h"
 
 #include <cassert>
 
@@ -0,0 +1,126 @@
+#include "MappedFile.h"
+
+#if PLATFORM_WIN32
+#include <windows.h>
+#else  // PLATFORM_WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // PLATFORM_WIN32
+
+MappedFile::MappedFile()
+	: m_pData(nullptr),
+	m_uiSize(0)
+#if PLATFORM_WIN32
+	, m_hFile(INVALID_HANDLE_VALUE),
+	m_hMapping(nullptr)
+#endif  // PLATFORM_WIN32
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#if PLATFORM_WIN32
+
+bool MappedFile::Open(const char* pFileName)
+{
+	Close();
+
+	m_hFile = CreateFileA(pFileName, GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_hFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_hFile, &size) || size.QuadPart <= 0)
+	{
+		Close();
+		return false;
+	}
+
+	m_hMapping = CreateFileMappingA(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_hMapping)
+	{
+		Close();
+		return false;
+	}
+
+	m_pData = static_cast<const byte*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+	if (!m_pData)
+	{
+		Close();
+		return false;
+	}
+	m_uiSize = static_cast<size_t>(size.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_pData)
+	{
+		UnmapViewOfFile(m_pData);
+		m_pData = nullptr;
+	}
+	if (m_hMapping)
+	{
+		CloseHandle(m_hMapping);
+		m_hMapping = nullptr;
+	}
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+	m_uiSize = 0;
+}
+
+#else  // PLATFORM_WIN32
+
+bool MappedFile::Open(const char* pFileName)
+{
+	Close();
+
+	const int fd = open(pFileName, O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	// The mapping remains valid once the descriptor is closed.
+	void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+
+	m_pData = static_cast<const byte*>(data);
+	m_uiSize = static_cast<size_t>(st.st_size);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_pData)
+	{
+		munmap(const_cast<byte*>(m_pData), m_uiSize);
+		m_pData = nullptr;
+	}
+	m_uiSize = 0;
+}
+
+#endif  // PLATFORM_WIN32
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "System.h"
+
+// Maps a whole file read-only in memory. Data is paged in by the OS on first
+// access, so nothing is copied, and pages of read-only mappings of the same
+// file are shared across processes.
+// The mapping is released when the object is destroyed, so views into data()
+// must not outlive it.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Delete copies, the mapping can only have one owner.
+	MappedFile(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile const&) = delete;
+
+	// Maps pFileName, releasing any previous mapping. Returns false if the file
+	// can't be opened or mapped. Empty files can't be mapped.
+	bool Open(const char* pFileName);
+
+	// Releases the mapping.
+	void Close();
+
+	bool IsOpen() const { return m_pData != nullptr; }
+
+	// Mapped data, aligned at least on the system page size.
+	const byte* data() const { return m_pData; }
+	size_t size() const { return m_uiSize; }
+
+private:
+	const byte* m_pData;
+	size_t m_uiSize;
+#if PLATFORM_WIN32
+	void* m_hFile;
+	void* m_hMapping;
+#endif  // PLATFORM_WIN32
+};
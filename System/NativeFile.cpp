@@ -0,0 +1,300 @@
+// 64 bits off_t on 32 bits POSIX targets.
+#define _FILE_OFFSET_BITS 64
+
+#include "NativeFile.h"
+
+#if PLATFORM_WIN32
+#include <windows.h>
+#else  // PLATFORM_WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // PLATFORM_WIN32
+
+#include <algorithm>
+
+NativeFile::NativeFile()
+#if PLATFORM_WIN32
+	: m_hFile(INVALID_HANDLE_VALUE),
+#else  // PLATFORM_WIN32
+	: m_iFile(-1),
+#endif  // PLATFORM_WIN32
+	m_uiSize(0)
+{
+}
+
+NativeFile::~NativeFile()
+{
+	Close();
+}
+
+bool NativeFile::ReadWholeFile(const char* pFileName, std::string& outData)
+{
+	NativeFile file;
+	if (!file.Open(pFileName, OM_READ, AP_SEQUENTIAL) ||
+		file.GetSize() > static_cast<uint64>(outData.max_size()))
+	{
+		return false;
+	}
+	outData.resize(static_cast<size_t>(file.GetSize()));
+	return outData.empty() || file.ReadAt(&outData[0], outData.size(), 0);
+}
+
+bool NativeFile::WriteWholeFile(const char* pFileName, const void* pData, uint64 uiSize)
+{
+	NativeFile file;
+	return file.Open(pFileName, OM_WRITE, AP_SEQUENTIAL) && (uiSize == 0 || file.WriteAt(pData, uiSize, 0));
+}
+
+#if PLATFORM_WIN32
+
+bool NativeFile::Open(const char* pFileName, uint uiOpenMode, uint uiAccessPattern)
+{
+	JY_ASSERT(uiOpenMode < OM_MAX);
+	JY_ASSERT(uiAccessPattern < AP_MAX);
+	Close();
+
+	DWORD dwFlags = FILE_ATTRIBUTE_NORMAL;
+	if (uiAccessPattern == AP_SEQUENTIAL)
+	{
+		dwFlags |= FILE_FLAG_SEQUENTIAL_SCAN;
+	}
+	else if (uiAccessPattern == AP_RANDOM)
+	{
+		dwFlags |= FILE_FLAG_RANDOM_ACCESS;
+	}
+
+	if (uiOpenMode == OM_READ)
+	{
+		m_hFile = CreateFileA(pFileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, dwFlags, nullptr);
+	}
+	else
+	{
+		m_hFile = CreateFileA(pFileName, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, dwFlags, nullptr);
+	}
+	if (m_hFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_hFile, &size))
+	{
+		Close();
+		return false;
+	}
+	m_uiSize = static_cast<uint64>(size.QuadPart);
+	return true;
+}
+
+void NativeFile::Close()
+{
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+	m_uiSize = 0;
+}
+
+bool NativeFile::IsOpen() const
+{
+	return m_hFile != INVALID_HANDLE_VALUE;
+}
+
+bool NativeFile::ReadAt(void* pBuffer, uint64 uiSize, uint64 uiOffset) const
+{
+	JY_ASSERT(IsOpen());
+	byte* pDest = static_cast<byte*>(pBuffer);
+	while (uiSize > 0)
+	{
+		// Transfers are limited to 32 bits sizes.
+		OVERLAPPED kOverlapped = {};
+		kOverlapped.Offset = static_cast<DWORD>(uiOffset);
+		kOverlapped.OffsetHigh = static_cast<DWORD>(uiOffset >> 32);
+		const DWORD dwChunk = static_cast<DWORD>(std::min<uint64>(uiSize, 0x40000000));
+		DWORD dwRead = 0;
+		if (!ReadFile(m_hFile, pDest, dwChunk, &dwRead, &kOverlapped) || dwRead == 0)
+		{
+			return false;
+		}
+		pDest += dwRead;
+		uiOffset += dwRead;
+		uiSize -= dwRead;
+	}
+	return true;
+}
+
+bool NativeFile::WriteAt(const void* pBuffer, uint64 uiSize, uint64 uiOffset)
+{
+	JY_ASSERT(IsOpen());
+	const byte* pSrc = static_cast<const byte*>(pBuffer);
+	while (uiSize > 0)
+	{
+		OVERLAPPED kOverlapped = {};
+		kOverlapped.Offset = static_cast<DWORD>(uiOffset);
+		kOverlapped.OffsetHigh = static_cast<DWORD>(uiOffset >> 32);
+		const DWORD dwChunk = static_cast<DWORD>(std::min<uint64>(uiSize, 0x40000000));
+		DWORD dwWritten = 0;
+		if (!WriteFile(m_hFile, pSrc, dwChunk, &dwWritten, &kOverlapped) || dwWritten == 0)
+		{
+			return false;
+		}
+		pSrc += dwWritten;
+		uiOffset += dwWritten;
+		uiSize -= dwWritten;
+		m_uiSize = std::max(m_uiSize, uiOffset);
+	}
+	return true;
+}
+
+bool NativeFile::Flush()
+{
+	JY_ASSERT(IsOpen());
+	return FlushFileBuffers(m_hFile) != 0;
+}
+
+bool NativeFile::GetFileSize(const char* pFileName, uint64& uiSize)
+{
+	WIN32_FILE_ATTRIBUTE_DATA kData;
+	if (!GetFileAttributesExA(pFileName, GetFileExInfoStandard, &kData))
+	{
+		return false;
+	}
+	uiSize = (static_cast<uint64>(kData.nFileSizeHigh) << 32) | kData.nFileSizeLow;
+	return true;
+}
+
+bool NativeFile::IsFileExists(const char* pFileName)
+{
+	return GetFileAttributesA(pFileName) != INVALID_FILE_ATTRIBUTES;
+}
+
+#else  // PLATFORM_WIN32
+
+bool NativeFile::Open(const char* pFileName, uint uiOpenMode, uint uiAccessPattern)
+{
+	JY_ASSERT(uiOpenMode < OM_MAX);
+	JY_ASSERT(uiAccessPattern < AP_MAX);
+	Close();
+
+	const int iFlags = uiOpenMode == OM_READ ? O_RDONLY : O_WRONLY | O_CREAT | O_TRUNC;
+	do
+	{
+		m_iFile = open(pFileName, iFlags | O_CLOEXEC, 0644);
+	} while (m_iFile < 0 && errno == EINTR);
+	if (m_iFile < 0)
+	{
+		return false;
+	}
+
+	struct stat kStat;
+	if (fstat(m_iFile, &kStat) != 0)
+	{
+		Close();
+		return false;
+	}
+	m_uiSize = static_cast<uint64>(kStat.st_size);
+
+#if defined(POSIX_FADV_SEQUENTIAL)
+	// Read-ahead hints, failures are harmless.
+	if (uiAccessPattern == AP_SEQUENTIAL)
+	{
+		posix_fadvise(m_iFile, 0, 0, POSIX_FADV_SEQUENTIAL);
+	}
+	else if (uiAccessPattern == AP_RANDOM)
+	{
+		posix_fadvise(m_iFile, 0, 0, POSIX_FADV_RANDOM);
+	}
+#endif  // POSIX_FADV_SEQUENTIAL
+	return true;
+}
+
+void NativeFile::Close()
+{
+	if (m_iFile >= 0)
+	{
+		close(m_iFile);
+		m_iFile = -1;
+	}
+	m_uiSize = 0;
+}
+
+bool NativeFile::IsOpen() const
+{
+	return m_iFile >= 0;
+}
+
+bool NativeFile::ReadAt(void* pBuffer, uint64 uiSize, uint64 uiOffset) const
+{
+	JY_ASSERT(IsOpen());
+	byte* pDest = static_cast<byte*>(pBuffer);
+	while (uiSize > 0)
+	{
+		// Large transfers may be partial, and are limited to SSIZE_MAX.
+		const size_t uiChunk = static_cast<size_t>(std::min<uint64>(uiSize, 0x40000000));
+		const ssize_t iRead = pread(m_iFile, pDest, uiChunk, static_cast<off_t>(uiOffset));
+		if (iRead < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (iRead <= 0)
+		{
+			return false;
+		}
+		pDest += iRead;
+		uiOffset += iRead;
+		uiSize -= iRead;
+	}
+	return true;
+}
+
+bool NativeFile::WriteAt(const void* pBuffer, uint64 uiSize, uint64 uiOffset)
+{
+	JY_ASSERT(IsOpen());
+	const byte* pSrc = static_cast<const byte*>(pBuffer);
+	while (uiSize > 0)
+	{
+		const size_t uiChunk = static_cast<size_t>(std::min<uint64>(uiSize, 0x40000000));
+		const ssize_t iWritten = pwrite(m_iFile, pSrc, uiChunk, static_cast<off_t>(uiOffset));
+		if (iWritten < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (iWritten <= 0)
+		{
+			return false;
+		}
+		pSrc += iWritten;
+		uiOffset += iWritten;
+		uiSize -= iWritten;
+		m_uiSize = std::max(m_uiSize, uiOffset);
+	}
+	return true;
+}
+
+bool NativeFile::Flush()
+{
+	JY_ASSERT(IsOpen());
+	return fsync(m_iFile) == 0;
+}
+
+bool NativeFile::GetFileSize(const char* pFileName, uint64& uiSize)
+{
+	struct stat kStat;
+	if (stat(pFileName, &kStat) != 0)
+	{
+		return false;
+	}
+	uiSize = static_cast<uint64>(kStat.st_size);
+	return true;
+}
+
+bool NativeFile::IsFileExists(const char* pFileName)
+{
+	struct stat kStat;
+	return stat(pFileName, &kStat) == 0;
+}
+
+#endif  // PLATFORM_WIN32
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "System.h"
+
+#include <string>
+
+// Unbuffered file handle over the native OS API: open/pread/pwrite on POSIX,
+// CreateFile/ReadFile/WriteFile on Windows. Sizes and offsets are 64 bits, so
+// files larger than 4GB are supported on every platform.
+// Reads and writes are positional and don't move any file pointer, so a same
+// file can be read from several threads at once. See MappedFile for read-only
+// memory mapping.
+class NativeFile
+{
+public:
+	enum	//Open Mode
+	{
+		OM_READ,	// Opens an existing file.
+		OM_WRITE,	// Creates or truncates a file.
+		OM_MAX
+	};
+	enum	//Access Pattern, a hint for the OS read-ahead and caching.
+	{
+		AP_NORMAL,
+		AP_SEQUENTIAL,
+		AP_RANDOM,
+		AP_MAX
+	};
+
+	NativeFile();
+	~NativeFile();
+
+	// Delete copies, the handle can only have one owner.
+	NativeFile(NativeFile const&) = delete;
+	NativeFile& operator=(NativeFile const&) = delete;
+
+	// Opens pFileName, closing any previously opened file.
+	bool Open(const char* pFileName, uint uiOpenMode, uint uiAccessPattern = AP_NORMAL);
+	void Close();
+
+	bool IsOpen() const;
+
+	// Size of the file, updated by writes.
+	uint64 GetSize() const { return m_uiSize; }
+
+	// Reads or writes exactly uiSize bytes at uiOffset, returns false
+	// otherwise.
+	bool ReadAt(void* pBuffer, uint64 uiSize, uint64 uiOffset) const;
+	bool WriteAt(const void* pBuffer, uint64 uiSize, uint64 uiOffset);
+
+	// Commits written data to the storage device.
+	bool Flush();
+
+	// Reads a whole file to outData.
+	static bool ReadWholeFile(const char* pFileName, std::string& outData);
+
+	// Creates or truncates pFileName, then writes uiSize bytes of pData to it.
+	static bool WriteWholeFile(const char* pFileName, const void* pData, uint64 uiSize);
+
+	// Gets the size of a file without opening it.
+	static bool GetFileSize(const char* pFileName, uint64& uiSize);
+
+	static bool IsFileExists(const char* pFileName);
+
+private:
+#if PLATFORM_WIN32
+	void* m_hFile;
+#else  // PLATFORM_WIN32
+	int m_iFile;
+#endif  // PLATFORM_WIN32
+	uint64 m_uiSize;
+};
@@ -60,6 +60,8 @@
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <map>
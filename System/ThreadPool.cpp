@@ -0,0 +1,117 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(uint _numThreads)
+	: m_stop(false)
+{
+	if (_numThreads == 0)
+	{
+		const uint hardware = std::thread::hardware_concurrency();
+		_numThreads = hardware > 1 ? hardware - 1 : 1;
+	}
+	m_threads.reserve(_numThreads);
+	for (uint i = 0; i < _numThreads; ++i)
+	{
+		m_threads.emplace_back(&ThreadPool::_WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_condition.notify_all();
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::Enqueue(Task _task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push(std::move(_task));
+	}
+	m_condition.notify_one();
+}
+
+void ThreadPool::_WorkerLoop()
+{
+	for (;;)
+	{
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+			if (m_tasks.empty())
+			{
+				return;
+			}
+			task = std::move(m_tasks.front());
+			m_tasks.pop();
+		}
+		task();
+	}
+}
+
+namespace
+{
+	// State of a ParallelFor, shared with the helper tasks. Helpers can start
+	// after all indices were consumed, and even after ParallelFor returned, so
+	// it's reference counted.
+	struct ParallelForState
+	{
+		std::function<void(int)> func;
+		int count;
+		std::atomic<int> next;
+		std::atomic<int> done;
+		std::mutex mutex;
+		std::condition_variable condition;
+
+		// Processes indices until there's none left.
+		void Process()
+		{
+			int completed = 0;
+			for (int i = next++; i < count; i = next++)
+			{
+				func(i);
+				++completed;
+			}
+			if (completed != 0 && (done += completed) == count)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				condition.notify_all();
+			}
+		}
+	};
+}  // namespace
+
+void ThreadPool::ParallelFor(int _count, const std::function<void(int)>& _func)
+{
+	if (_count <= 0)
+	{
+		return;
+	}
+
+	std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+	state->func = _func;
+	state->count = _count;
+	state->next = 0;
+	state->done = 0;
+
+	// The calling thread takes one share of the work.
+	const int helpers = std::min(static_cast<int>(m_threads.size()), _count - 1);
+	for (int i = 0; i < helpers; ++i)
+	{
+		Enqueue([state] { state->Process(); });
+	}
+	state->Process();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->condition.wait(lock, [&state] { return state->done == state->count; });
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "DataStruct.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// A fixed set of worker threads, executing tasks from a shared FIFO queue.
+class SYSTEM_API ThreadPool
+{
+public:
+	typedef std::function<void()> Task;
+
+	// Creates _numThreads workers. 0 creates one worker per hardware thread,
+	// minus the calling one which is expected to take part to ParallelFor.
+	explicit ThreadPool(uint _numThreads = 0);
+
+	// Waits for queued tasks to complete, and joins workers.
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	uint GetNumThreads() const { return static_cast<uint>(m_threads.size()); }
+
+	// Queues a task, to be executed by the first available worker.
+	void Enqueue(Task _task);
+
+	// Calls _func(i) for every i in [0,_count[, distributed between the workers
+	// and the calling thread. Returns once all calls have completed, so _func
+	// can safely reference the caller's stack.
+	void ParallelFor(int _count, const std::function<void(int)>& _func);
+
+private:
+	void _WorkerLoop();
+
+	Vector<std::thread> m_threads;
+	STDQueue<Task> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stop;
+};
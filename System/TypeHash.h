@@ -47,6 +47,15 @@ inline uint PointerHash(const void* Key, uint C = 0)
 // Hash functions for common types.
 //
 
+/**
+ * 32 bits FNV-1a hash of a null terminated string. It is constexpr so that
+ * hashes of string literals can be computed at compile time.
+ */
+constexpr uint HashString(const char* Str, uint Hash = 2166136261u)
+{
+	return *Str ? HashString(Str + 1, (Hash ^ static_cast<byte>(*Str)) * 16777619u) : Hash;
+}
+
 inline uint GetTypeHash(const byte A)
 {
 	return A;
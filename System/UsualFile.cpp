@@ -1,65 +1,47 @@
 #include "UsualFile.h"
 
-#include <tchar.h>
-#include <sys/stat.h>
-
-char UsualFile::ms_cOpenMode[OM_MAX][5] = 
-{
-	("rb"),
-	("wb"),
-	("rt"),
-	("wt"),
-};
-
-uint UsualFile::m_uiSeekFlag[] = 
-{
-	SEEK_CUR,
-	SEEK_END,
-	SEEK_SET
-};
-
 bool UsualFile::IsFileExists(const char * pFileName)
 {
-	struct _stat64i32 kStat;
-	if (_tstat(pFileName, &kStat) != 0)
-	{
-		return false;
-	}
-	return true;
+	return NativeFile::IsFileExists(pFileName);
 }
 
 UsualFile::UsualFile()
 {
-	m_pFileHandle = NULL;
+	m_uiPosition = 0;
 	m_uiOpenMode = OM_MAX;
-	m_uiFileSize = 0;
 }
 
 UsualFile::~UsualFile()
 {
-	if (m_pFileHandle)
-	{
-		fclose(m_pFileHandle);
-		m_pFileHandle = NULL;
-	}
+	m_kFile.Close();
 }
 
-bool UsualFile::Seek(uint uiOffset,uint uiOrigin)
+bool UsualFile::Seek(int64 iOffset, uint uiOrigin)
 {
-	JY_ASSERT(m_pFileHandle);
-	fseek(m_pFileHandle,uiOffset,uiOrigin);
+	JY_ASSERT(m_kFile.IsOpen());
+	JY_ASSERT(uiOrigin < SF_MAX);
+	int64 iBase = 0;
+	if (uiOrigin == SF_CUR)
+	{
+		iBase = static_cast<int64>(m_uiPosition);
+	}
+	else if (uiOrigin == SF_END)
+	{
+		iBase = static_cast<int64>(m_kFile.GetSize());
+	}
+	if (iBase + iOffset < 0)
+	{
+		return false;
+	}
+	m_uiPosition = static_cast<uint64>(iBase + iOffset);
 	return true;
 }
 
 bool UsualFile::Open(const char * pFileName, uint uiOpenMode)
 {
-	if (m_pFileHandle)
-	{
-		fclose(m_pFileHandle);
-	}
-	JY_ASSERT(!m_pFileHandle);
+	m_kFile.Close();
 	JY_ASSERT(uiOpenMode < OM_MAX);
-	uint uiLen = strlen(pFileName);
+	USIZE_TYPE uiLen = strlen(pFileName);
 	if (uiLen < VSMAX_PATH - 1)
 	{
 		if(!Memcpy(m_tcFileName,pFileName,uiLen + 1))
@@ -71,50 +53,42 @@ bool UsualFile::Open(const char * pFileName, uint uiOpenMode)
 	}
 
 	m_uiOpenMode = uiOpenMode;
-	if (m_uiOpenMode == OM_RB || m_uiOpenMode == OM_RT)
-	{
-		struct _stat64i32 kStat;
-		if (_tstat(pFileName,&kStat) != 0)
-		{
-			return false;
-		}
-		m_uiFileSize = kStat.st_size;
-	}
-
-	errno_t uiError = _tfopen_s(&m_pFileHandle,pFileName,ms_cOpenMode[m_uiOpenMode]);
-	if (uiError)
-	{
-		return 0;
-	}
-	if (!m_pFileHandle)
-	{
-		return 0;
-	}
-
-	return true;
+	m_uiPosition = 0;
+	const bool bRead = m_uiOpenMode == OM_RB || m_uiOpenMode == OM_RT;
+	return m_kFile.Open(pFileName, bRead ? NativeFile::OM_READ : NativeFile::OM_WRITE, NativeFile::AP_SEQUENTIAL);
 }
 
-bool UsualFile::Write(const void *pBuffer, uint uiSize, uint uiCount)
+bool UsualFile::Write(const void *pBuffer, uint64 uiSize, uint64 uiCount)
 {
-	JY_ASSERT(m_pFileHandle);
+	JY_ASSERT(m_kFile.IsOpen());
 	JY_ASSERT(pBuffer);
 	JY_ASSERT(uiSize);
 	JY_ASSERT(uiCount);
-	fwrite(pBuffer,uiSize,uiCount,m_pFileHandle);
+	const uint64 uiTotal = uiSize * uiCount;
+	if (!m_kFile.WriteAt(pBuffer, uiTotal, m_uiPosition))
+	{
+		return false;
+	}
+	m_uiPosition += uiTotal;
 	return true;
 }
 
-bool UsualFile::Read(void *pBuffer,uint uiSize,uint uiCount)
+bool UsualFile::Read(void *pBuffer, uint64 uiSize, uint64 uiCount)
 {
-	JY_ASSERT(m_pFileHandle);
+	JY_ASSERT(m_kFile.IsOpen());
 	JY_ASSERT(pBuffer);
 	JY_ASSERT(uiSize);
 	JY_ASSERT(uiCount);
-	fread(pBuffer,uiSize,uiCount,m_pFileHandle);
+	const uint64 uiTotal = uiSize * uiCount;
+	if (!m_kFile.ReadAt(pBuffer, uiTotal, m_uiPosition))
+	{
+		return false;
+	}
+	m_uiPosition += uiTotal;
 	return true;
 }
 
 bool UsualFile::Flush()
 {
-	return(fflush(m_pFileHandle) == 0);
-}
\ No newline at end of file
+	return m_kFile.Flush();
+}
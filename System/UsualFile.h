@@ -1,7 +1,10 @@
 #pragma once
 
 #include "System.h"
+#include "NativeFile.h"
 
+// Sequential file access over NativeFile, with 64 bits sizes and offsets.
+// Text modes are kept for compatibility but don't translate line endings.
 class UsualFile
 {
 public:
@@ -29,22 +32,24 @@ public:
 	~UsualFile();
 	bool Flush();
 
-	bool Seek(uint uiOffset, uint uiOrigin);
+	bool Seek(int64 iOffset, uint uiOrigin);
 	bool Open(const char* pFileName, uint uiOpenMode);
-	bool Write(const void *pBuffer, uint uiSize, uint uiCount = 1);
-	bool Read(void *pBuffer, uint uiSize, uint uiCount);
+	bool Write(const void *pBuffer, uint64 uiSize, uint64 uiCount = 1);
+	bool Read(void *pBuffer, uint64 uiSize, uint64 uiCount);
 	
-	inline uint GetFileSize()const
+	inline uint64 GetFileSize()const
 	{
-		return m_uiFileSize;
+		return m_kFile.GetSize();
+	}
+	inline uint64 Tell()const
+	{
+		return m_uiPosition;
 	}
 	static bool IsFileExists(const char * pFileName);
 protected:
-	static char ms_cOpenMode[OM_MAX][5];
-	static uint m_uiSeekFlag[];
-	FILE  *m_pFileHandle;
+	NativeFile m_kFile;
+	uint64 m_uiPosition;
 	uint m_uiOpenMode;
-	uint m_uiFileSize;
 	char m_tcFileName[VSMAX_PATH];
 	
 };